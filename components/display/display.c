@@ -0,0 +1,222 @@
+/**
+ * @file display.c
+ *
+ * Panel independent drawing: clipping, batching into address windows and
+ * frame timing. Pixels are packed by the backend's specialized packer.
+ */
+#include "display.h"
+#include <stdlib.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#else
+#include <time.h>
+#endif
+
+int64_t display_time_us(void)
+{
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+void display_attach(display_t *disp, const display_ops_t *ops, void *ctx)
+{
+    disp->ops = ops;
+    disp->ctx = ctx;
+    memset(&disp->stats, 0, sizeof(disp->stats));
+    disp->frame_start_us = 0;
+    display_reset_clip(disp);
+}
+
+void display_set_clip(display_t *disp, int x, int y, int w, int h)
+{
+    int x1 = x + w, y1 = y + h;
+
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x1 > disp->ops->width) x1 = disp->ops->width;
+    if (y1 > disp->ops->height) y1 = disp->ops->height;
+
+    disp->clip_x0 = x;
+    disp->clip_y0 = y;
+    disp->clip_x1 = x1 > x ? x1 : x;
+    disp->clip_y1 = y1 > y ? y1 : y;
+}
+
+void display_reset_clip(display_t *disp)
+{
+    display_set_clip(disp, 0, 0, disp->ops->width, disp->ops->height);
+}
+
+int display_fill_rect(display_t *disp, int x, int y, int w, int h, display_color_t color)
+{
+    const display_ops_t *ops = disp->ops;
+
+    if (x < disp->clip_x0) { w -= disp->clip_x0 - x; x = disp->clip_x0; }
+    if (y < disp->clip_y0) { h -= disp->clip_y0 - y; y = disp->clip_y0; }
+    if (x + w > disp->clip_x1) w = disp->clip_x1 - x;
+    if (y + h > disp->clip_y1) h = disp->clip_y1 - y;
+    if (w <= 0 || h <= 0)
+        return 0;
+
+    int ret = ops->window(disp, x, y, w, h);
+    if (ret)
+        return ret;
+    disp->stats.windows++;
+
+    // One color: pack a buffer once and send it as often as needed
+    uint32_t pixels = (uint32_t)w * h;
+    uint32_t chunk = DISPLAY_BUF_SIZE / ops->bytes_per_pixel;
+    ops->pack_fill(disp->buf, color, pixels < chunk ? pixels : chunk);
+    while (pixels)
+    {
+        uint32_t n = pixels < chunk ? pixels : chunk;
+        ret = ops->write(disp, disp->buf, n * ops->bytes_per_pixel);
+        if (ret)
+            return ret;
+        disp->stats.bytes += n * ops->bytes_per_pixel;
+        pixels -= n;
+    }
+    return 0;
+}
+
+int display_fill_screen(display_t *disp, display_color_t color)
+{
+    return display_fill_rect(disp, 0, 0, disp->ops->width, disp->ops->height, color);
+}
+
+int display_draw_pixel(display_t *disp, int x, int y, display_color_t color)
+{
+    return display_fill_rect(disp, x, y, 1, 1, color);
+}
+
+int display_draw_line(display_t *disp, int x0, int y0, int x1, int y1, display_color_t color)
+{
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx - dy;
+    int ret = 0;
+
+    // Current straight run along the major axis
+    int rx = x0, ry = y0, len = 0;
+    int x_major = dx >= dy;
+
+    while (1)
+    {
+        if (len && (x_major ? y0 != ry : x0 != rx))
+        {
+            // Run ended, send it as one window
+            if (x_major)
+                ret |= display_fill_rect(disp, sx > 0 ? rx : rx - len + 1, ry, len, 1, color);
+            else
+                ret |= display_fill_rect(disp, rx, sy > 0 ? ry : ry - len + 1, 1, len, color);
+            rx = x0;
+            ry = y0;
+            len = 0;
+        }
+        len++;
+
+        if (x0 == x1 && y0 == y1)
+            break;
+
+        int e2 = 2 * err;
+        if (e2 > -dy)
+        {
+            err -= dy;
+            x0 += sx;
+        }
+        if (e2 < dx)
+        {
+            err += dx;
+            y0 += sy;
+        }
+    }
+
+    if (x_major)
+        ret |= display_fill_rect(disp, sx > 0 ? rx : rx - len + 1, ry, len, 1, color);
+    else
+        ret |= display_fill_rect(disp, rx, sy > 0 ? ry : ry - len + 1, 1, len, color);
+    return ret;
+}
+
+// One run of the octant next to the x axis, rows ys..ye at column x, and
+// its seven reflections
+static int circle_runs(display_t *disp, int x0, int y0, int x, int ys, int ye, display_color_t color)
+{
+    int n = ye - ys + 1;
+    int ret = 0;
+
+    ret |= display_fill_rect(disp, x0 + x, y0 + ys, 1, n, color);
+    ret |= display_fill_rect(disp, x0 - x, y0 + ys, 1, n, color);
+    ret |= display_fill_rect(disp, x0 + x, y0 - ye, 1, n, color);
+    ret |= display_fill_rect(disp, x0 - x, y0 - ye, 1, n, color);
+    ret |= display_fill_rect(disp, x0 + ys, y0 + x, n, 1, color);
+    ret |= display_fill_rect(disp, x0 - ye, y0 + x, n, 1, color);
+    ret |= display_fill_rect(disp, x0 + ys, y0 - x, n, 1, color);
+    ret |= display_fill_rect(disp, x0 - ye, y0 - x, n, 1, color);
+    return ret;
+}
+
+int display_draw_circle(display_t *disp, int x0, int y0, int radius, display_color_t color)
+{
+    int x = radius;
+    int y = 0;
+    int err = 0;
+    int ys = 0; // First row of the current run
+    int ret = 0;
+
+    while (x >= y)
+    {
+        int px = x;
+        int py = y;
+
+        if (err <= 0)
+        {
+            y += 1;
+            err += 2 * y + 1;
+        }
+        if (err > 0)
+        {
+            x -= 1;
+            err -= 2 * x + 1;
+        }
+
+        // Run ends where the column steps in, or at the diagonal
+        if (x != px || x < y)
+        {
+            ret |= circle_runs(disp, x0, y0, px, ys, py, color);
+            ys = y;
+        }
+    }
+    return ret;
+}
+
+void display_frame_begin(display_t *disp)
+{
+    disp->stats.windows = 0;
+    disp->stats.bytes = 0;
+    disp->frame_start_us = display_time_us();
+}
+
+void display_frame_end(display_t *disp)
+{
+    display_stats_t *s = &disp->stats;
+    uint32_t us = (uint32_t)(display_time_us() - disp->frame_start_us);
+
+    s->frames++;
+    s->last_us = us;
+    s->total_us += us;
+    if (us > s->max_us)
+        s->max_us = us;
+    if (s->windows > s->max_windows)
+        s->max_windows = s->windows;
+    if (s->bytes > s->max_bytes)
+        s->max_bytes = s->bytes;
+}
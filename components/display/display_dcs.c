@@ -0,0 +1,201 @@
+/**
+ * @file display_dcs.c
+ *
+ * Display backends for MIPI DCS style SPI TFT controllers: ST7789 and
+ * ILI9341. Both share the window/RAM write commands and differ in the
+ * init sequence, geometry and pixel format.
+ */
+#include "display_panels.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+
+#define DCS_SWRESET 0x01
+#define DCS_SLPOUT  0x11
+#define DCS_NORON   0x13
+#define DCS_INVON   0x21
+#define DCS_DISPON  0x29
+#define DCS_CASET   0x2A
+#define DCS_RASET   0x2B
+#define DCS_RAMWR   0x2C
+#define DCS_MADCTL  0x36
+#define DCS_COLMOD  0x3A
+
+#define COLMOD_RGB565 0x55
+#define COLMOD_RGB666 0x66
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+
+static const char *TAG = "display_dcs";
+
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t len;
+    uint8_t data[4];
+    uint8_t delay_ms;
+} dcs_init_cmd_t;
+
+typedef struct
+{
+    spi_device_handle_t spi;
+    gpio_num_t dc;
+    uint16_t x_offset;
+    uint16_t y_offset;
+} dcs_ctx_t;
+
+static esp_err_t dcs_send(dcs_ctx_t *ctx, int dc, const uint8_t *data, size_t len)
+{
+    if (!len)
+        return ESP_OK;
+
+    gpio_set_level(ctx->dc, dc);
+    spi_transaction_t t = {
+        .length = len * 8,
+        .tx_buffer = data,
+    };
+    return spi_device_polling_transmit(ctx->spi, &t);
+}
+
+static esp_err_t dcs_command(dcs_ctx_t *ctx, uint8_t cmd, const uint8_t *data, size_t len)
+{
+    CHECK(dcs_send(ctx, 0, &cmd, 1));
+    return dcs_send(ctx, 1, data, len);
+}
+
+static int dcs_window(display_t *disp, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    dcs_ctx_t *ctx = disp->ctx;
+    uint16_t x0 = x + ctx->x_offset, x1 = x0 + w - 1;
+    uint16_t y0 = y + ctx->y_offset, y1 = y0 + h - 1;
+    uint8_t col[4] = { x0 >> 8, x0 & 0xFF, x1 >> 8, x1 & 0xFF };
+    uint8_t row[4] = { y0 >> 8, y0 & 0xFF, y1 >> 8, y1 & 0xFF };
+
+    CHECK(dcs_command(ctx, DCS_CASET, col, 4));
+    CHECK(dcs_command(ctx, DCS_RASET, row, 4));
+    return dcs_command(ctx, DCS_RAMWR, NULL, 0);
+}
+
+static int dcs_write(display_t *disp, const uint8_t *data, size_t len)
+{
+    return dcs_send(disp->ctx, 1, data, len);
+}
+
+static esp_err_t dcs_init(dcs_ctx_t *ctx, const display_spi_config_t *cfg, int default_clock_hz,
+                          const dcs_init_cmd_t *seq, size_t seq_len)
+{
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << cfg->dc) | (1ULL << cfg->rst),
+        .mode = GPIO_MODE_OUTPUT,
+    };
+    CHECK(gpio_config(&io_conf));
+
+    spi_bus_config_t bus_cfg = {
+        .mosi_io_num = cfg->mosi,
+        .miso_io_num = -1,
+        .sclk_io_num = cfg->sclk,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = DISPLAY_BUF_SIZE,
+    };
+    esp_err_t ret = spi_bus_initialize(cfg->host, &bus_cfg, SPI_DMA_CH_AUTO);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE)
+        return ret;
+
+    spi_device_interface_config_t dev_cfg = {
+        .clock_speed_hz = cfg->clock_hz ? cfg->clock_hz : default_clock_hz,
+        .mode = 0,
+        .spics_io_num = cfg->cs,
+        .queue_size = 7,
+    };
+    CHECK(spi_bus_add_device(cfg->host, &dev_cfg, &ctx->spi));
+    ctx->dc = cfg->dc;
+
+    gpio_set_level(cfg->rst, 0);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    gpio_set_level(cfg->rst, 1);
+    vTaskDelay(pdMS_TO_TICKS(120));
+
+    for (size_t i = 0; i < seq_len; i++)
+    {
+        CHECK(dcs_command(ctx, seq[i].cmd, seq[i].data, seq[i].len));
+        if (seq[i].delay_ms)
+            vTaskDelay(pdMS_TO_TICKS(seq[i].delay_ms));
+    }
+    return ESP_OK;
+}
+
+// ST7789
+
+DISPLAY_DEFINE_PACKER(st7789, ST7789_PANEL_FORMAT, ST7789_PANEL_ORDER)
+
+static const dcs_init_cmd_t st7789_init_seq[] = {
+    { DCS_SWRESET, 0, { 0 }, 150 },
+    { DCS_SLPOUT, 0, { 0 }, 120 },
+    { DCS_COLMOD, 1, { COLMOD_RGB565 }, 10 },
+    { DCS_MADCTL, 1, { 0x00 }, 0 },
+    { DCS_INVON, 0, { 0 }, 10 }, // IPS panels are inverted
+    { DCS_NORON, 0, { 0 }, 10 },
+    { DCS_DISPON, 0, { 0 }, 10 },
+};
+
+static const display_ops_t st7789_ops = {
+    .name = "st7789",
+    .width = ST7789_PANEL_WIDTH,
+    .height = ST7789_PANEL_HEIGHT,
+    .bytes_per_pixel = DISPLAY_FMT_BYTES(ST7789_PANEL_FORMAT),
+    .pack_fill = st7789_pack_fill,
+    .window = dcs_window,
+    .write = dcs_write,
+};
+
+static dcs_ctx_t s_st7789 = {
+    .x_offset = ST7789_PANEL_X_OFFSET,
+    .y_offset = ST7789_PANEL_Y_OFFSET,
+};
+
+esp_err_t display_st7789_init(display_t *disp, const display_spi_config_t *cfg)
+{
+    CHECK(dcs_init(&s_st7789, cfg, 40 * 1000 * 1000, st7789_init_seq,
+                   sizeof(st7789_init_seq) / sizeof(st7789_init_seq[0])));
+    display_attach(disp, &st7789_ops, &s_st7789);
+    ESP_LOGI(TAG, "ST7789 initialized (%dx%d)", ST7789_PANEL_WIDTH, ST7789_PANEL_HEIGHT);
+    return ESP_OK;
+}
+
+// ILI9341
+
+DISPLAY_DEFINE_PACKER(ili9341, ILI9341_PANEL_FORMAT, ILI9341_PANEL_ORDER)
+
+static const dcs_init_cmd_t ili9341_init_seq[] = {
+    { DCS_SWRESET, 0, { 0 }, 150 },
+    { 0xC0, 1, { 0x23 }, 0 },       // Power control 1
+    { 0xC1, 1, { 0x10 }, 0 },       // Power control 2
+    { 0xC5, 2, { 0x3E, 0x28 }, 0 }, // VCOM control 1
+    { 0xC7, 1, { 0x86 }, 0 },       // VCOM control 2
+    { DCS_MADCTL, 1, { 0x28 }, 0 }, // Landscape, BGR
+    { DCS_COLMOD, 1, { ILI9341_PANEL_FORMAT == DISPLAY_FMT_RGB666 ? COLMOD_RGB666 : COLMOD_RGB565 }, 0 },
+    { DCS_SLPOUT, 0, { 0 }, 120 },
+    { DCS_DISPON, 0, { 0 }, 10 },
+};
+
+static const display_ops_t ili9341_ops = {
+    .name = "ili9341",
+    .width = ILI9341_PANEL_WIDTH,
+    .height = ILI9341_PANEL_HEIGHT,
+    .bytes_per_pixel = DISPLAY_FMT_BYTES(ILI9341_PANEL_FORMAT),
+    .pack_fill = ili9341_pack_fill,
+    .window = dcs_window,
+    .write = dcs_write,
+};
+
+static dcs_ctx_t s_ili9341;
+
+esp_err_t display_ili9341_init(display_t *disp, const display_spi_config_t *cfg)
+{
+    CHECK(dcs_init(&s_ili9341, cfg, 26 * 1000 * 1000, ili9341_init_seq,
+                   sizeof(ili9341_init_seq) / sizeof(ili9341_init_seq[0])));
+    display_attach(disp, &ili9341_ops, &s_ili9341);
+    ESP_LOGI(TAG, "ILI9341 initialized (%dx%d)", ILI9341_PANEL_WIDTH, ILI9341_PANEL_HEIGHT);
+    return ESP_OK;
+}
@@ -0,0 +1,239 @@
+/**
+ * @file display_host.c
+ *
+ * In-memory display backend for the host: renders into a frame buffer in
+ * the emulated panel's own geometry and wire format and saves it as PPM.
+ *
+ * Build the per-panel frame cost benchmark with:
+ *
+ *     gcc -O2 -DDISPLAY_HOST_BENCH -Icomponents/display/include \
+ *         components/display/display.c components/display/radar_view.c \
+ *         components/display/display_host.c -lm -o display_bench
+ */
+#ifndef ESP_PLATFORM
+
+#include "display_panels.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct
+{
+    uint8_t *fb;
+    uint8_t format;
+    uint8_t order;
+    uint16_t wx, wy, ww, wh; //!< Current window
+    uint32_t pos;            //!< Pixels written into the window
+} host_ctx_t;
+
+static int host_window(display_t *disp, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    host_ctx_t *ctx = disp->ctx;
+
+    ctx->wx = x;
+    ctx->wy = y;
+    ctx->ww = w;
+    ctx->wh = h;
+    ctx->pos = 0;
+    return 0;
+}
+
+static int host_write(display_t *disp, const uint8_t *data, size_t len)
+{
+    host_ctx_t *ctx = disp->ctx;
+    uint8_t bpp = disp->ops->bytes_per_pixel;
+    uint32_t n = len / bpp;
+
+    // Row by row, like the panel's RAM address counter
+    while (n && ctx->pos < (uint32_t)ctx->ww * ctx->wh)
+    {
+        uint32_t col = ctx->pos % ctx->ww;
+        uint32_t run = ctx->ww - col;
+        if (run > n)
+            run = n;
+        size_t offset = ((size_t)(ctx->wy + ctx->pos / ctx->ww) * disp->ops->width + ctx->wx + col) * bpp;
+        memcpy(ctx->fb + offset, data, run * bpp);
+        data += run * bpp;
+        ctx->pos += run;
+        n -= run;
+    }
+    return 0;
+}
+
+#define HOST_PANEL(prefix, w, h, fmt, ord)                 \
+    DISPLAY_DEFINE_PACKER(prefix, fmt, ord)               \
+    static const display_ops_t prefix##_ops = {            \
+        .name = "host-" #prefix,                           \
+        .width = w,                                        \
+        .height = h,                                       \
+        .bytes_per_pixel = DISPLAY_FMT_BYTES(fmt),         \
+        .pack_fill = prefix##_pack_fill,                   \
+        .window = host_window,                             \
+        .write = host_write,                               \
+    };
+
+HOST_PANEL(ssd1351, SSD1351_PANEL_WIDTH, SSD1351_PANEL_HEIGHT, SSD1351_PANEL_FORMAT, SSD1351_PANEL_ORDER)
+HOST_PANEL(st7789, ST7789_PANEL_WIDTH, ST7789_PANEL_HEIGHT, ST7789_PANEL_FORMAT, ST7789_PANEL_ORDER)
+HOST_PANEL(ili9341, ILI9341_PANEL_WIDTH, ILI9341_PANEL_HEIGHT, ILI9341_PANEL_FORMAT, ILI9341_PANEL_ORDER)
+
+static const struct
+{
+    const display_ops_t *ops;
+    uint8_t format;
+    uint8_t order;
+} host_panels[DISPLAY_HOST_PANELS] = {
+    [DISPLAY_HOST_SSD1351] = { &ssd1351_ops, SSD1351_PANEL_FORMAT, SSD1351_PANEL_ORDER },
+    [DISPLAY_HOST_ST7789] = { &st7789_ops, ST7789_PANEL_FORMAT, ST7789_PANEL_ORDER },
+    [DISPLAY_HOST_ILI9341] = { &ili9341_ops, ILI9341_PANEL_FORMAT, ILI9341_PANEL_ORDER },
+};
+
+int display_host_init(display_t *disp, display_host_panel_t panel)
+{
+    if (panel >= DISPLAY_HOST_PANELS)
+        return -1;
+
+    const display_ops_t *ops = host_panels[panel].ops;
+    host_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return -1;
+    ctx->fb = calloc((size_t)ops->width * ops->height, ops->bytes_per_pixel);
+    if (!ctx->fb)
+    {
+        free(ctx);
+        return -1;
+    }
+    ctx->format = host_panels[panel].format;
+    ctx->order = host_panels[panel].order;
+
+    display_attach(disp, ops, ctx);
+    return 0;
+}
+
+void display_host_free(display_t *disp)
+{
+    host_ctx_t *ctx = disp->ctx;
+
+    if (ctx)
+    {
+        free(ctx->fb);
+        free(ctx);
+        disp->ctx = NULL;
+    }
+}
+
+int display_host_write_ppm(const display_t *disp, const char *path)
+{
+    const host_ctx_t *ctx = disp->ctx;
+    const display_ops_t *ops = disp->ops;
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+
+    fprintf(f, "P6\n%u %u\n255\n", ops->width, ops->height);
+    const uint8_t *p = ctx->fb;
+    for (uint32_t i = 0; i < (uint32_t)ops->width * ops->height; i++, p += ops->bytes_per_pixel)
+    {
+        uint8_t rgb[3];
+        if (ctx->format == DISPLAY_FMT_RGB565)
+        {
+            uint16_t c = ctx->order == DISPLAY_ORDER_BE ? (p[0] << 8 | p[1]) : (p[1] << 8 | p[0]);
+            rgb[0] = (c >> 8 & 0xF8) | (c >> 13);
+            rgb[1] = (c >> 3 & 0xFC) | (c >> 9 & 0x03);
+            rgb[2] = (c << 3 & 0xF8) | (c >> 2 & 0x07);
+        }
+        else
+        {
+            rgb[0] = p[ctx->order == DISPLAY_ORDER_BE ? 0 : 2];
+            rgb[1] = p[1];
+            rgb[2] = p[ctx->order == DISPLAY_ORDER_BE ? 2 : 0];
+        }
+        fwrite(rgb, 1, 3, f);
+    }
+    return fclose(f) ? -1 : 0;
+}
+
+#ifdef DISPLAY_HOST_BENCH
+
+#include "radar_view.h"
+
+// Panel SPI clocks the estimate assumes, see the backend defaults
+static const uint32_t bench_spi_hz[DISPLAY_HOST_PANELS] = {
+    [DISPLAY_HOST_SSD1351] = 1000000,
+    [DISPLAY_HOST_ST7789] = 40000000,
+    [DISPLAY_HOST_ILI9341] = 26000000,
+};
+
+// Command and parameter bytes to open one address window
+#define WINDOW_OVERHEAD_BYTES 11
+
+// Trigger to trigger at the firmware defaults, see SCAN_PLAN_HOST_CHECK. A
+// frame is drawn per bearing, it has to fit
+#define BENCH_PERIOD_US 34100
+
+// Erasing the sweep at every bearing must leave exactly the grid behind
+static int check_erase(display_t *disp)
+{
+    host_ctx_t *ctx = disp->ctx;
+    size_t size = (size_t)disp->ops->width * disp->ops->height * disp->ops->bytes_per_pixel;
+    uint8_t *grid = malloc(size);
+    radar_view_t view;
+    int fail = 0;
+
+    if (!grid)
+        return 1;
+    radar_view_layout(&view, display_width(disp), display_height(disp));
+    display_fill_screen(disp, DISPLAY_BLACK);
+    radar_view_draw_grid(disp, &view, DISPLAY_DARK_GREEN);
+    memcpy(grid, ctx->fb, size);
+
+    for (int angle = 180; angle <= 360; angle++)
+    {
+        radar_view_draw_sweep(disp, &view, angle, DISPLAY_GREEN);
+        radar_view_erase_sweep(disp, &view, angle, DISPLAY_BLACK, DISPLAY_DARK_GREEN);
+        if (memcmp(grid, ctx->fb, size))
+        {
+            printf("%s: grid not restored at %d deg\n", disp->ops->name, angle);
+            memcpy(ctx->fb, grid, size);
+            fail = 1;
+        }
+    }
+    free(grid);
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000;
+    int fail = 0;
+
+    for (int p = 0; p < DISPLAY_HOST_PANELS; p++)
+    {
+        static display_t disp;
+        if (display_host_init(&disp, p))
+            return 1;
+
+        fail |= check_erase(&disp);
+        radar_view_bench(&disp, frames);
+        const display_stats_t *s = &disp.stats;
+        double spi_ms = (s->max_bytes + (double)s->max_windows * WINDOW_OVERHEAD_BYTES) * 8.0 / bench_spi_hz[p] * 1000.0;
+        printf("%-14s %3ux%-3u %.2f us/frame (max %u), max %u windows, %u bytes/frame, ~%.1f ms SPI at %u MHz\n",
+               disp.ops->name, disp.ops->width, disp.ops->height, (double)s->total_us / s->frames, s->max_us,
+               s->max_windows, s->max_bytes, spi_ms, bench_spi_hz[p] / 1000000);
+        if (spi_ms * 1000 > BENCH_PERIOD_US)
+        {
+            printf("%s: frame longer than the %u us scan period\n", disp.ops->name, BENCH_PERIOD_US);
+            fail = 1;
+        }
+
+        char path[64];
+        snprintf(path, sizeof(path), "radar_%s.ppm", disp.ops->name);
+        display_host_write_ppm(&disp, path);
+        display_host_free(&disp);
+    }
+
+    printf(fail ? "FAIL\n" : "OK\n");
+    return fail;
+}
+
+#endif /* DISPLAY_HOST_BENCH */
+
+#endif /* ESP_PLATFORM */
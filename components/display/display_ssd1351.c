@@ -0,0 +1,41 @@
+/**
+ * @file display_ssd1351.c
+ *
+ * Display backend for the SSD1351 128x128 RGB OLED
+ */
+#include "display_panels.h"
+#include <ssd1351.h>
+
+DISPLAY_DEFINE_PACKER(ssd1351, SSD1351_PANEL_FORMAT, SSD1351_PANEL_ORDER)
+
+static ssd1351_t s_dev;
+
+static int ssd1351_window(display_t *disp, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    return ssd1351_set_window(disp->ctx, x, y, x + w - 1, y + h - 1);
+}
+
+static int ssd1351_write(display_t *disp, const uint8_t *data, size_t len)
+{
+    return ssd1351_write_pixels(disp->ctx, data, len);
+}
+
+static const display_ops_t ssd1351_ops = {
+    .name = "ssd1351",
+    .width = SSD1351_PANEL_WIDTH,
+    .height = SSD1351_PANEL_HEIGHT,
+    .bytes_per_pixel = DISPLAY_FMT_BYTES(SSD1351_PANEL_FORMAT),
+    .pack_fill = ssd1351_pack_fill,
+    .window = ssd1351_window,
+    .write = ssd1351_write,
+};
+
+esp_err_t display_ssd1351_init(display_t *disp, const display_spi_config_t *cfg)
+{
+    esp_err_t ret = ssd1351_init(&s_dev, cfg->host, cfg->mosi, cfg->sclk, cfg->cs, cfg->dc, cfg->rst, cfg->clock_hz);
+    if (ret != ESP_OK)
+        return ret;
+
+    display_attach(disp, &ssd1351_ops, &s_dev);
+    return ESP_OK;
+}
@@ -0,0 +1,217 @@
+#ifndef __DISPLAY_H__
+#define __DISPLAY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Colors are RGB565 in the drawing API and packed to the panel format on output
+typedef uint16_t display_color_t;
+
+#define DISPLAY_BLACK      0x0000
+#define DISPLAY_WHITE      0xFFFF
+#define DISPLAY_RED        0xF800
+#define DISPLAY_GREEN      0x07E0
+#define DISPLAY_DARK_GREEN 0x03E0
+#define DISPLAY_BLUE       0x001F
+#define DISPLAY_YELLOW     0xFFE0
+
+// Wire pixel formats
+#define DISPLAY_FMT_RGB565 0 //!< 2 bytes
+#define DISPLAY_FMT_RGB666 1 //!< 3 bytes, 6 bits each in the upper bits
+#define DISPLAY_FMT_RGB888 2 //!< 3 bytes
+
+#define DISPLAY_FMT_BYTES(fmt) ((fmt) == DISPLAY_FMT_RGB565 ? 2 : 3)
+
+// Byte order of multi-byte formats on the wire
+#define DISPLAY_ORDER_BE 0
+#define DISPLAY_ORDER_LE 1
+
+// Staging buffer for packed pixels, one transfer at most
+#define DISPLAY_BUF_SIZE 1536
+
+typedef struct display display_t;
+
+/**
+ * Panel backend
+ *
+ * Geometry and the packer are fixed per panel at compile time, see
+ * `DISPLAY_DEFINE_PACKER`.
+ */
+typedef struct
+{
+    const char *name;
+    uint16_t width;
+    uint16_t height;
+    uint8_t bytes_per_pixel;
+    void (*pack_fill)(uint8_t *dst, display_color_t color, uint32_t n);               //!< n copies of one color
+    int (*window)(display_t *disp, uint16_t x, uint16_t y, uint16_t w, uint16_t h); //!< Start a write, 0 on success
+    int (*write)(display_t *disp, const uint8_t *data, size_t len);                  //!< Pixels into the window, 0 on success
+} display_ops_t;
+
+/**
+ * Frame cost counters, between `display_frame_begin()` and `display_frame_end()`
+ */
+typedef struct
+{
+    uint32_t frames;
+    uint32_t last_us;   //!< Duration of the last frame
+    uint32_t max_us;    //!< Longest frame since the counters were reset
+    uint64_t total_us;  //!< Sum over `frames`
+    uint32_t windows;     //!< Address windows set in the last frame
+    uint32_t bytes;       //!< Pixel bytes sent in the last frame
+    uint32_t max_windows; //!< Most windows in one frame since the counters were reset
+    uint32_t max_bytes;   //!< Most pixel bytes in one frame since the counters were reset
+} display_stats_t;
+
+struct display
+{
+    const display_ops_t *ops;
+    void *ctx; //!< Backend state
+    display_stats_t stats;
+    int64_t frame_start_us;
+    int16_t clip_x0, clip_y0, clip_x1, clip_y1; //!< Drawing is limited to this box, end exclusive
+    uint8_t buf[DISPLAY_BUF_SIZE];
+};
+
+/**
+ * @brief Pack one RGB565 color into a wire format
+ *
+ * Always inlined with constant `fmt` and `order`, so every instantiation
+ * compiles to straight-line code for its panel.
+ */
+static inline __attribute__((always_inline)) void display_pack_one(uint8_t *dst, display_color_t c, int fmt, int order)
+{
+    if (fmt == DISPLAY_FMT_RGB565)
+    {
+        dst[order == DISPLAY_ORDER_BE ? 0 : 1] = c >> 8;
+        dst[order == DISPLAY_ORDER_BE ? 1 : 0] = c & 0xFF;
+        return;
+    }
+
+    uint8_t r = (c >> 8) & 0xF8;
+    uint8_t g = (c >> 3) & 0xFC;
+    uint8_t b = (c << 3) & 0xF8;
+    if (fmt == DISPLAY_FMT_RGB888)
+    {
+        // Replicate the top bits so white stays 0xFF
+        r |= r >> 5;
+        g |= g >> 6;
+        b |= b >> 5;
+    }
+    dst[order == DISPLAY_ORDER_BE ? 0 : 2] = r;
+    dst[1] = g;
+    dst[order == DISPLAY_ORDER_BE ? 2 : 0] = b;
+}
+
+/**
+ * Instantiate the packer of a panel, `prefix##_pack_fill`, specialized for
+ * one format and byte order. Everything drawn is a run of one color.
+ */
+#define DISPLAY_DEFINE_PACKER(prefix, fmt, order)                                  \
+    static void prefix##_pack_fill(uint8_t *dst, display_color_t color, uint32_t n) \
+    {                                                                               \
+        uint8_t px[3];                                                              \
+        display_pack_one(px, color, fmt, order);                                    \
+        for (uint32_t i = 0; i < n; i++, dst += DISPLAY_FMT_BYTES(fmt))             \
+            memcpy(dst, px, DISPLAY_FMT_BYTES(fmt));                                \
+    }
+
+/**
+ * @brief Attach a backend
+ *
+ * Called by the backend init functions.
+ *
+ * @param disp Display
+ * @param ops Backend operations
+ * @param ctx Backend state
+ */
+void display_attach(display_t *disp, const display_ops_t *ops, void *ctx);
+
+static inline uint16_t display_width(const display_t *disp) { return disp->ops->width; }
+static inline uint16_t display_height(const display_t *disp) { return disp->ops->height; }
+
+/**
+ * @brief Limit drawing to a rectangle
+ *
+ * Lets a caller redraw only the part of a shape that was overwritten: the
+ * shape's windows outside the box are not sent at all.
+ *
+ * @param disp Display
+ * @param x Left column
+ * @param y Top row
+ * @param w Width, clipped to the panel
+ * @param h Height, clipped to the panel
+ */
+void display_set_clip(display_t *disp, int x, int y, int w, int h);
+
+/**
+ * @brief Draw on the whole panel again
+ *
+ * @param disp Display
+ */
+void display_reset_clip(display_t *disp);
+
+/**
+ * @brief Fill a rectangle, clipped to the panel and the clip box
+ *
+ * @return 0 on success
+ */
+int display_fill_rect(display_t *disp, int x, int y, int w, int h, display_color_t color);
+
+/**
+ * @brief Fill the whole panel
+ *
+ * @return 0 on success
+ */
+int display_fill_screen(display_t *disp, display_color_t color);
+
+/**
+ * @brief Draw one pixel, ignored outside the panel
+ *
+ * @return 0 on success
+ */
+int display_draw_pixel(display_t *disp, int x, int y, display_color_t color);
+
+/**
+ * @brief Draw a line
+ *
+ * Straight runs are sent as one window each instead of pixel by pixel.
+ *
+ * @return 0 on success
+ */
+int display_draw_line(display_t *disp, int x0, int y0, int x1, int y1, display_color_t color);
+
+/**
+ * @brief Draw a circle outline
+ *
+ * Sent as one window per straight run of each octant, not per pixel.
+ *
+ * @return 0 on success
+ */
+int display_draw_circle(display_t *disp, int x0, int y0, int radius, display_color_t color);
+
+/**
+ * @brief Start timing a frame
+ */
+void display_frame_begin(display_t *disp);
+
+/**
+ * @brief Stop timing a frame and update `disp->stats`
+ */
+void display_frame_end(display_t *disp);
+
+/**
+ * @brief Monotonic time for frame timing, us
+ */
+int64_t display_time_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DISPLAY_H__ */
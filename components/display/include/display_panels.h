@@ -0,0 +1,133 @@
+#ifndef __DISPLAY_PANELS_H__
+#define __DISPLAY_PANELS_H__
+
+#include "display.h"
+
+#ifdef ESP_PLATFORM
+#include <driver/spi_master.h>
+#include <driver/gpio.h>
+#include <esp_err.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Compile-time panel parameters, override with -D for other module sizes
+
+// SSD1351 128x128 RGB OLED
+#define SSD1351_PANEL_WIDTH  128
+#define SSD1351_PANEL_HEIGHT 128
+#define SSD1351_PANEL_FORMAT DISPLAY_FMT_RGB565
+#define SSD1351_PANEL_ORDER  DISPLAY_ORDER_BE
+
+// ST7789 IPS TFT, 240x240 modules by default
+#ifndef ST7789_PANEL_WIDTH
+#define ST7789_PANEL_WIDTH    240
+#define ST7789_PANEL_HEIGHT   240
+#endif
+#ifndef ST7789_PANEL_X_OFFSET
+#define ST7789_PANEL_X_OFFSET 0
+#define ST7789_PANEL_Y_OFFSET 0
+#endif
+#define ST7789_PANEL_FORMAT   DISPLAY_FMT_RGB565
+#define ST7789_PANEL_ORDER    DISPLAY_ORDER_BE
+
+// ILI9341 TFT, 320x240 landscape; 18-bit color with -DILI9341_PANEL_RGB666
+#define ILI9341_PANEL_WIDTH  320
+#define ILI9341_PANEL_HEIGHT 240
+#ifdef ILI9341_PANEL_RGB666
+#define ILI9341_PANEL_FORMAT DISPLAY_FMT_RGB666
+#else
+#define ILI9341_PANEL_FORMAT DISPLAY_FMT_RGB565
+#endif
+#define ILI9341_PANEL_ORDER  DISPLAY_ORDER_BE
+
+#ifdef ESP_PLATFORM
+
+/**
+ * SPI wiring of a panel
+ */
+typedef struct
+{
+    spi_host_device_t host;
+    gpio_num_t mosi;
+    gpio_num_t sclk;
+    gpio_num_t cs;
+    gpio_num_t dc;
+    gpio_num_t rst;
+    int clock_hz; //!< SPI clock, 0 for the panel default
+} display_spi_config_t;
+
+/**
+ * @brief Init an SSD1351 OLED backend
+ *
+ * @param disp Display to attach the backend to
+ * @param cfg SPI wiring
+ * @return `ESP_OK` on success
+ */
+esp_err_t display_ssd1351_init(display_t *disp, const display_spi_config_t *cfg);
+
+/**
+ * @brief Init an ST7789 TFT backend
+ *
+ * @param disp Display to attach the backend to
+ * @param cfg SPI wiring
+ * @return `ESP_OK` on success
+ */
+esp_err_t display_st7789_init(display_t *disp, const display_spi_config_t *cfg);
+
+/**
+ * @brief Init an ILI9341 TFT backend
+ *
+ * @param disp Display to attach the backend to
+ * @param cfg SPI wiring
+ * @return `ESP_OK` on success
+ */
+esp_err_t display_ili9341_init(display_t *disp, const display_spi_config_t *cfg);
+
+#else
+
+/**
+ * Panels the host backend can stand in for, same geometry and wire format
+ */
+typedef enum
+{
+    DISPLAY_HOST_SSD1351 = 0,
+    DISPLAY_HOST_ST7789,
+    DISPLAY_HOST_ILI9341,
+    DISPLAY_HOST_PANELS,
+} display_host_panel_t;
+
+/**
+ * @brief Init an in-memory backend emulating a panel
+ *
+ * @param disp Display to attach the backend to
+ * @param panel Panel to emulate
+ * @return 0 on success
+ */
+int display_host_init(display_t *disp, display_host_panel_t panel);
+
+/**
+ * @brief Free the frame buffer of a host backend
+ *
+ * @param disp Display
+ */
+void display_host_free(display_t *disp);
+
+/**
+ * @brief Save the frame buffer as a binary PPM image
+ *
+ * @param disp Display
+ * @param path Output file
+ * @return 0 on success
+ */
+int display_host_write_ppm(const display_t *disp, const char *path);
+
+#endif /* ESP_PLATFORM */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DISPLAY_PANELS_H__ */
@@ -0,0 +1,91 @@
+#ifndef __RADAR_VIEW_H__
+#define __RADAR_VIEW_H__
+
+#include "display.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Radar half-disc laid out for a panel
+ *
+ * Bearings are in the radar frame: 180 = left, 270 = up, 360 = right.
+ */
+typedef struct
+{
+    int16_t cx;     //!< Center, bottom middle
+    int16_t cy;
+    int16_t radius; //!< Full range, pixels
+    int16_t blip;   //!< Blip size, pixels, odd
+} radar_view_t;
+
+/**
+ * @brief Scale the view to a panel
+ *
+ * @param view Layout to fill
+ * @param width Panel width
+ * @param height Panel height
+ */
+void radar_view_layout(radar_view_t *view, uint16_t width, uint16_t height);
+
+/**
+ * @brief Pixel at a bearing and fraction of full range
+ *
+ * @param view Layout
+ * @param angle_deg Bearing, degrees
+ * @param frac Range as a fraction of full range
+ * @param x Pixel column
+ * @param y Pixel row
+ */
+void radar_view_point(const radar_view_t *view, int angle_deg, float frac, int *x, int *y);
+
+/**
+ * @brief Draw the range rings and bearing lines
+ *
+ * @return 0 on success
+ */
+int radar_view_draw_grid(display_t *disp, const radar_view_t *view, display_color_t color);
+
+/**
+ * @brief Draw the sweep line at a bearing
+ *
+ * @return 0 on success
+ */
+int radar_view_draw_sweep(display_t *disp, const radar_view_t *view, int angle_deg, display_color_t color);
+
+/**
+ * @brief Erase the sweep line at a bearing and restore the grid under it
+ *
+ * Only the grid pieces in small boxes along the line are redrawn, a
+ * handful of windows instead of the whole grid.
+ *
+ * @return 0 on success
+ */
+int radar_view_erase_sweep(display_t *disp, const radar_view_t *view, int angle_deg, display_color_t background,
+                           display_color_t grid);
+
+/**
+ * @brief Draw a blip centered on a pixel
+ *
+ * @return 0 on success
+ */
+int radar_view_draw_blip(display_t *disp, const radar_view_t *view, int x, int y, display_color_t color);
+
+/**
+ * @brief Render synthetic sweep frames to measure frame cost
+ *
+ * Each frame is what the display task does per bearing: erase the old
+ * sweep line and the grid under it, draw the new line and a blip.
+ * Results are in `disp->stats`.
+ *
+ * @param disp Display
+ * @param frames Number of frames
+ */
+void radar_view_bench(display_t *disp, uint32_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RADAR_VIEW_H__ */
@@ -0,0 +1,124 @@
+/**
+ * @file radar_view.c
+ *
+ * Radar view layout and drawing on any display backend
+ */
+#include "radar_view.h"
+#include <math.h>
+#include <stdlib.h>
+
+// Pixels along the sweep line per grid restore box. Smaller boxes resend
+// fewer grid pixels next to the line but redraw the grid more often
+#define ERASE_STEP 8
+
+void radar_view_layout(radar_view_t *view, uint16_t width, uint16_t height)
+{
+    int margin = (width < height ? width : height) / 32;
+    if (margin < 2)
+        margin = 2;
+
+    int radius = width / 2 - margin;
+    if (radius > height - 2 * margin)
+        radius = height - 2 * margin;
+
+    view->cx = width / 2;
+    // Leave a quarter of the spare height below the base line (110 on a 128 px panel)
+    view->cy = height - 1 - (height - radius) / 4;
+    view->radius = radius;
+    view->blip = (radius / 12) | 1;
+    if (view->blip < 5)
+        view->blip = 5;
+}
+
+void radar_view_point(const radar_view_t *view, int angle_deg, float frac, int *x, int *y)
+{
+    float rad = angle_deg * (float)M_PI / 180.0f;
+
+    *x = view->cx + (int)(frac * view->radius * cosf(rad));
+    *y = view->cy + (int)(frac * view->radius * sinf(rad));
+}
+
+int radar_view_draw_grid(display_t *disp, const radar_view_t *view, display_color_t color)
+{
+    int ret = 0;
+    int r = view->radius;
+
+    for (int i = 1; i <= 3; i++)
+        ret |= display_draw_circle(disp, view->cx, view->cy, r * i / 3, color);
+
+    ret |= display_draw_line(disp, view->cx - r, view->cy, view->cx + r, view->cy, color);
+    for (int angle = 225; angle <= 315; angle += 45)
+        ret |= radar_view_draw_sweep(disp, view, angle, color);
+    return ret;
+}
+
+int radar_view_draw_sweep(display_t *disp, const radar_view_t *view, int angle_deg, display_color_t color)
+{
+    int x, y;
+
+    radar_view_point(view, angle_deg, 1.0f, &x, &y);
+    return display_draw_line(disp, view->cx, view->cy, x, y, color);
+}
+
+int radar_view_erase_sweep(display_t *disp, const radar_view_t *view, int angle_deg, display_color_t background,
+                           display_color_t grid)
+{
+    int x1, y1;
+    int ret = radar_view_draw_sweep(disp, view, angle_deg, background);
+
+    radar_view_point(view, angle_deg, 1.0f, &x1, &y1);
+    int dx = x1 - view->cx;
+    int dy = y1 - view->cy;
+    int steps = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+
+    // Boxes along the line, one pixel wider on each side to cover where the
+    // line rasterizes off the straight interpolation
+    for (int i = 0; i < steps || i == 0; i += ERASE_STEP)
+    {
+        int j = i + ERASE_STEP < steps ? i + ERASE_STEP : steps;
+        int xa = view->cx + (steps ? dx * i / steps : 0), ya = view->cy + (steps ? dy * i / steps : 0);
+        int xb = view->cx + (steps ? dx * j / steps : 0), yb = view->cy + (steps ? dy * j / steps : 0);
+        int x = (xa < xb ? xa : xb) - 1;
+        int y = (ya < yb ? ya : yb) - 1;
+
+        display_set_clip(disp, x, y, abs(xb - xa) + 3, abs(yb - ya) + 3);
+        ret |= radar_view_draw_grid(disp, view, grid);
+    }
+    display_reset_clip(disp);
+    return ret;
+}
+
+int radar_view_draw_blip(display_t *disp, const radar_view_t *view, int x, int y, display_color_t color)
+{
+    int half = view->blip / 2;
+
+    return display_fill_rect(disp, x - half, y - half, view->blip, view->blip, color);
+}
+
+void radar_view_bench(display_t *disp, uint32_t frames)
+{
+    radar_view_t view;
+    int angle = 180, step = 3, prev = 180;
+
+    radar_view_layout(&view, display_width(disp), display_height(disp));
+    display_fill_screen(disp, DISPLAY_BLACK);
+    radar_view_draw_grid(disp, &view, DISPLAY_DARK_GREEN);
+    memset(&disp->stats, 0, sizeof(disp->stats));
+
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        int x, y;
+
+        display_frame_begin(disp);
+        radar_view_erase_sweep(disp, &view, prev, DISPLAY_BLACK, DISPLAY_DARK_GREEN);
+        radar_view_draw_sweep(disp, &view, angle, DISPLAY_GREEN);
+        radar_view_point(&view, angle, 0.3f + 0.6f * (i % 7) / 7.0f, &x, &y);
+        radar_view_draw_blip(disp, &view, x, y, DISPLAY_RED);
+        display_frame_end(disp);
+
+        prev = angle;
+        angle += step;
+        if (angle >= 360 || angle <= 180)
+            step = -step;
+    }
+}
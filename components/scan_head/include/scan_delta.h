@@ -0,0 +1,86 @@
+#ifndef __SCAN_DELTA_H__
+#define __SCAN_DELTA_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAN_DELTA_MAX_BINS 181 //!< 1 degree bins over a 180 degree sweep
+
+/**
+ * Why a bin has to be reported
+ */
+typedef enum
+{
+    SCAN_DELTA_SKIP = 0, //!< Nothing new, do not send or redraw
+    SCAN_DELTA_CHANGED,  //!< Range moved past the threshold, or a return appeared or vanished
+    SCAN_DELTA_REFRESH,  //!< Unchanged return, last report is older than the timeout
+    SCAN_DELTA_KEYFRAME, //!< Periodic full resync
+} scan_delta_result_t;
+
+/**
+ * Change detection configuration
+ */
+typedef struct
+{
+    int16_t start_deg;     //!< Bearing of bin 0
+    uint8_t bin_deg;       //!< Bin width, degrees
+    uint16_t threshold_mm; //!< Smaller range changes are not reported
+    uint32_t timeout_ms;   //!< Returns are re-reported at least this often, 0 to disable
+    uint32_t keyframe_ms;  //!< Every bin is re-reported at least this often, 0 to disable
+} scan_delta_config_t;
+
+/**
+ * Last reported range per angle bin
+ */
+typedef struct
+{
+    scan_delta_config_t cfg;
+    int32_t range_mm[SCAN_DELTA_MAX_BINS]; //!< Last reported range, -1 for no return
+    uint32_t sent_ms[SCAN_DELTA_MAX_BINS]; //!< Time of the last report
+    uint32_t keyframe_ms;                  //!< Start of the last keyframe
+    uint32_t pending[(SCAN_DELTA_MAX_BINS + 31) / 32]; //!< Bins still owed to the current keyframe
+} scan_delta_t;
+
+/**
+ * @brief Init the change detector
+ *
+ * Every bin starts dirty so the first sweep is reported in full.
+ *
+ * @param delta Detector state
+ * @param cfg Configuration
+ * @param now_ms Current time, ms
+ */
+void scan_delta_init(scan_delta_t *delta, const scan_delta_config_t *cfg, uint32_t now_ms);
+
+/**
+ * @brief Bin index of a bearing
+ *
+ * @param delta Detector state
+ * @param angle Bearing, degrees
+ * @return Bin index, clamped to the valid range
+ */
+uint16_t scan_delta_bin(const scan_delta_t *delta, int16_t angle);
+
+/**
+ * @brief Account for a measurement and decide whether to report it
+ *
+ * Unreported measurements do not move the reference, so slow drift is
+ * reported once it adds up to the threshold.
+ *
+ * @param delta Detector state
+ * @param angle Bearing, degrees
+ * @param range_mm Measured range, negative for no return
+ * @param now_ms Current time, ms
+ * @return Reason to report, or `SCAN_DELTA_SKIP`
+ */
+scan_delta_result_t scan_delta_update(scan_delta_t *delta, int16_t angle, int32_t range_mm, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCAN_DELTA_H__ */
@@ -0,0 +1,147 @@
+#ifndef __SCAN_PLAN_H__
+#define __SCAN_PLAN_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Motion model of the scan head
+ *
+ * Time from commanding a step of `d` degrees until the head is still at
+ * the new bearing:
+ *
+ *     dead_us + slew_us_per_deg * d + settle_us + settle_us_per_deg2 * d * d
+ *
+ * The dead time covers the command latency (a hobby servo picks up a new
+ * pulse width on the next 20 ms PWM frame); ringing grows with the step.
+ */
+typedef struct
+{
+    uint32_t dead_us;            //!< Command to first motion, us
+    uint32_t slew_us_per_deg;    //!< Travel time per degree, us
+    uint32_t settle_us;          //!< Ringing after any move, us
+    uint32_t settle_us_per_deg2; //!< Extra ringing per squared degree of step, us
+} scan_motion_t;
+
+/**
+ * Sweep requirements
+ */
+typedef struct
+{
+    int16_t start_deg;        //!< First bearing, radar frame (180 = left, 360 = right)
+    int16_t end_deg;          //!< Last bearing, >= start_deg, equal parks the head on one bearing
+    uint8_t resolution_deg;   //!< Target angular resolution, largest step allowed
+    uint32_t listen_us;       //!< Head must hold still from trigger to end of the echo window, us
+    uint32_t min_interval_us; //!< Lower bound between triggers, us
+} scan_plan_config_t;
+
+/**
+ * Step size and timing chosen for a sweep
+ */
+typedef struct
+{
+    uint8_t step_deg;   //!< Degrees between bearings
+    uint32_t move_us;   //!< Step command until the head is still, us
+    uint32_t dwell_us;  //!< Time spent at each bearing, us
+    uint32_t period_us; //!< Trigger to trigger, move_us + dwell_us
+    uint32_t sweep_us;  //!< One sweep from start to end
+} scan_plan_t;
+
+/**
+ * Bearing sequencer
+ *
+ * Ping-pongs over the sweep with the planned step and tells the caller
+ * when the head has reached the commanded bearing, so the ping goes out
+ * the moment the head is still instead of on a fixed tick.
+ */
+typedef struct
+{
+    scan_plan_config_t cfg;
+    scan_motion_t motion;
+    scan_plan_t plan;
+    int16_t bearing;      //!< Commanded bearing
+    int8_t dir;           //!< +1 or -1
+    int64_t ready_us;     //!< Head still at `bearing` from this time
+    int64_t next_trig_us; //!< Earliest trigger allowed by the ping spacing
+} scan_seq_t;
+
+/**
+ * @brief Time to settle after a step
+ *
+ * @param motion Motion model
+ * @param step_deg Step, degrees
+ * @return Command to still, us
+ */
+uint32_t scan_motion_time_us(const scan_motion_t *motion, uint32_t step_deg);
+
+/**
+ * @brief Pick the step size that covers the sweep fastest
+ *
+ * Steps up to the target resolution are tried. Small steps pay the fixed
+ * dead and settle times more often, large steps ring longer; every
+ * bearing also holds still for the echo window and respects the minimum
+ * trigger spacing.
+ *
+ * @param plan Filled with the chosen step and timing
+ * @param cfg Sweep requirements
+ * @param motion Motion model
+ */
+void scan_plan_optimize(scan_plan_t *plan, const scan_plan_config_t *cfg, const scan_motion_t *motion);
+
+/**
+ * @brief Start a sweep at `cfg->start_deg`
+ *
+ * Plans the sweep and assumes the head needs a full-span move to reach
+ * the first bearing.
+ *
+ * @param seq Sequencer state
+ * @param cfg Sweep requirements
+ * @param motion Motion model
+ * @param now_us Current time, us
+ */
+void scan_seq_init(scan_seq_t *seq, const scan_plan_config_t *cfg, const scan_motion_t *motion, int64_t now_us);
+
+/**
+ * @brief Time to send the ping at the current bearing
+ *
+ * @param seq Sequencer state
+ * @return Trigger time, us
+ */
+int64_t scan_seq_trigger_time(const scan_seq_t *seq);
+
+/**
+ * @brief Move on once the ping at the current bearing is over
+ *
+ * @param seq Sequencer state
+ * @param trig_us Time the ping was sent, us
+ * @param done_us Time the echo ended (the head may move from here), us
+ * @param gap_us Spacing to the next trigger, e.g. from the ping scheduler, us
+ * @return Next bearing, to be commanded now
+ */
+int16_t scan_seq_advance(scan_seq_t *seq, int64_t trig_us, int64_t done_us, uint32_t gap_us);
+
+/**
+ * @brief Run the sequencer against the motion model on virtual time
+ *
+ * For checking a plan off-target: every ping listens for `echo_us` and
+ * the next trigger is spaced by `gap_us`.
+ *
+ * @param cfg Sweep requirements
+ * @param motion Motion model
+ * @param sweeps Number of sweeps to run
+ * @param echo_us Time from trigger to end of each echo, us
+ * @param gap_us Trigger spacing, us
+ * @param bearings Optional, total bearings measured
+ * @return Simulated time, us
+ */
+int64_t scan_seq_simulate(const scan_plan_config_t *cfg, const scan_motion_t *motion, uint32_t sweeps,
+                          uint32_t echo_us, uint32_t gap_us, uint32_t *bearings);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCAN_PLAN_H__ */
@@ -0,0 +1,51 @@
+#ifndef __SCAN_SERVO_H__
+#define __SCAN_SERVO_H__
+
+#include <stdint.h>
+#include <driver/gpio.h>
+#include <driver/ledc.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hobby servo on an LEDC channel, 50 Hz PWM
+ */
+typedef struct
+{
+    gpio_num_t gpio;        //!< PWM output
+    ledc_timer_t timer;     //!< LEDC timer, runs at 50 Hz
+    ledc_channel_t channel; //!< LEDC channel
+    uint16_t min_pulse_us;  //!< Pulse width at `min_deg`, us
+    uint16_t max_pulse_us;  //!< Pulse width at `max_deg`, us
+    int16_t min_deg;        //!< Bearing at the shortest pulse, radar frame
+    int16_t max_deg;        //!< Bearing at the longest pulse, radar frame
+} scan_servo_t;
+
+/**
+ * @brief Init the LEDC timer and channel, output stays off until the first bearing
+ *
+ * @param servo Pointer to the servo descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t scan_servo_init(const scan_servo_t *servo);
+
+/**
+ * @brief Command a bearing
+ *
+ * Takes effect on the next PWM frame; bearings outside the servo range
+ * are clamped.
+ *
+ * @param servo Pointer to the servo descriptor
+ * @param bearing_deg Bearing, radar frame
+ * @return `ESP_OK` on success
+ */
+esp_err_t scan_servo_set(const scan_servo_t *servo, int16_t bearing_deg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SCAN_SERVO_H__ */
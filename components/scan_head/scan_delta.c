@@ -0,0 +1,184 @@
+/**
+ * @file scan_delta.c
+ *
+ * Change-only reporting: per angle bin, only ranges that moved past a
+ * threshold are passed on, plus timed refreshes and periodic keyframes.
+ *
+ * Has no ESP-IDF dependencies so it can be built and checked on the host:
+ *
+ *     gcc -O2 -DSCAN_DELTA_HOST_CHECK -Icomponents/scan_head/include \
+ *         components/scan_head/scan_delta.c -o scan_delta_check
+ */
+#include "scan_delta.h"
+#include <string.h>
+
+static void start_keyframe(scan_delta_t *delta, uint32_t now_ms)
+{
+    memset(delta->pending, 0xff, sizeof(delta->pending));
+    delta->keyframe_ms = now_ms;
+}
+
+void scan_delta_init(scan_delta_t *delta, const scan_delta_config_t *cfg, uint32_t now_ms)
+{
+    delta->cfg = *cfg;
+    if (!delta->cfg.bin_deg)
+        delta->cfg.bin_deg = 1;
+
+    for (int i = 0; i < SCAN_DELTA_MAX_BINS; i++)
+    {
+        delta->range_mm[i] = -1;
+        delta->sent_ms[i] = now_ms;
+    }
+    start_keyframe(delta, now_ms);
+}
+
+uint16_t scan_delta_bin(const scan_delta_t *delta, int16_t angle)
+{
+    int32_t bin = (angle - delta->cfg.start_deg) / delta->cfg.bin_deg;
+
+    if (bin < 0)
+        return 0;
+    if (bin >= SCAN_DELTA_MAX_BINS)
+        return SCAN_DELTA_MAX_BINS - 1;
+    return (uint16_t)bin;
+}
+
+scan_delta_result_t scan_delta_update(scan_delta_t *delta, int16_t angle, int32_t range_mm, uint32_t now_ms)
+{
+    const scan_delta_config_t *cfg = &delta->cfg;
+    uint16_t bin = scan_delta_bin(delta, angle);
+    int32_t last = delta->range_mm[bin];
+    scan_delta_result_t result = SCAN_DELTA_SKIP;
+
+    if (range_mm < 0)
+        range_mm = -1;
+
+    // Keyframe is done once every bin has been reported since it started; bins
+    // the head never visits are written off when the next one is due
+    if (cfg->keyframe_ms && now_ms - delta->keyframe_ms >= cfg->keyframe_ms)
+        start_keyframe(delta, now_ms);
+
+    uint32_t mask = 1u << (bin & 31);
+    if (delta->pending[bin >> 5] & mask)
+    {
+        result = SCAN_DELTA_KEYFRAME;
+    }
+    else if ((range_mm < 0) != (last < 0))
+    {
+        result = SCAN_DELTA_CHANGED;
+    }
+    else if (range_mm >= 0)
+    {
+        int32_t diff = range_mm > last ? range_mm - last : last - range_mm;
+        if (diff > cfg->threshold_mm)
+            result = SCAN_DELTA_CHANGED;
+        else if (cfg->timeout_ms && now_ms - delta->sent_ms[bin] >= cfg->timeout_ms)
+            result = SCAN_DELTA_REFRESH;
+    }
+
+    if (result != SCAN_DELTA_SKIP)
+    {
+        delta->pending[bin >> 5] &= ~mask;
+        delta->range_mm[bin] = range_mm;
+        delta->sent_ms[bin] = now_ms;
+    }
+
+    return result;
+}
+
+#ifdef SCAN_DELTA_HOST_CHECK
+
+#include <stdio.h>
+
+// Firmware defaults, see main/radar_sensor.c
+#define CHECK_THRESHOLD_MM 30
+#define CHECK_TIMEOUT_MS   30000
+#define CHECK_KEYFRAME_MS  60000
+
+static const char *const result_names[] = { "skip", "changed", "refresh", "keyframe" };
+
+static int check(scan_delta_t *delta, const char *what, int16_t angle, int32_t range_mm, uint32_t now_ms,
+                 scan_delta_result_t expect)
+{
+    scan_delta_result_t got = scan_delta_update(delta, angle, range_mm, now_ms);
+    int fail = got != expect;
+
+    printf("%-36s %4d deg %6ld mm %6lu ms  %-8s %s\n", what, angle, (long)range_mm, (unsigned long)now_ms,
+           result_names[got], fail ? "FAIL" : "ok");
+    return fail;
+}
+
+// One scripted bin history per reporting rule, then the saving over
+// sweeps of a static scene with a little noise
+int main(void)
+{
+    const scan_delta_config_t cfg = {
+        .start_deg = 180,
+        .bin_deg = 1,
+        .threshold_mm = CHECK_THRESHOLD_MM,
+        .timeout_ms = CHECK_TIMEOUT_MS,
+        .keyframe_ms = CHECK_KEYFRAME_MS,
+    };
+    static scan_delta_t delta;
+    int fail = 0;
+
+    scan_delta_init(&delta, &cfg, 0);
+
+    // First sweep is the initial keyframe, empty bins included
+    fail |= check(&delta, "first sweep, return", 200, 1500, 10, SCAN_DELTA_KEYFRAME);
+    fail |= check(&delta, "first sweep, no return", 201, -1, 10, SCAN_DELTA_KEYFRAME);
+
+    // Within the threshold of the last report
+    fail |= check(&delta, "unchanged", 200, 1500, 2000, SCAN_DELTA_SKIP);
+    fail |= check(&delta, "noise under the threshold", 200, 1500 + CHECK_THRESHOLD_MM, 4000, SCAN_DELTA_SKIP);
+    fail |= check(&delta, "still no return", 201, -5, 4000, SCAN_DELTA_SKIP);
+    fail |= check(&delta, "moved past the threshold", 200, 1400, 6000, SCAN_DELTA_CHANGED);
+
+    // Unreported steps do not move the reference
+    fail |= check(&delta, "drift, 20 mm", 200, 1420, 8000, SCAN_DELTA_SKIP);
+    fail |= check(&delta, "drift, 40 mm", 200, 1440, 10000, SCAN_DELTA_CHANGED);
+
+    fail |= check(&delta, "return vanished", 200, -1, 12000, SCAN_DELTA_CHANGED);
+    fail |= check(&delta, "return appeared", 201, 900, 12000, SCAN_DELTA_CHANGED);
+
+    // Returns are re-sent after the timeout, empty bins wait for the keyframe
+    fail |= check(&delta, "return, before the timeout", 201, 900, 12000 + CHECK_TIMEOUT_MS - 1, SCAN_DELTA_SKIP);
+    fail |= check(&delta, "return, timed out", 201, 900, 12000 + CHECK_TIMEOUT_MS, SCAN_DELTA_REFRESH);
+    fail |= check(&delta, "no return, past the timeout", 200, -1, 12000 + CHECK_TIMEOUT_MS, SCAN_DELTA_SKIP);
+
+    // Every bin once per keyframe, then quiet again
+    fail |= check(&delta, "keyframe, no return", 200, -1, CHECK_KEYFRAME_MS, SCAN_DELTA_KEYFRAME);
+    fail |= check(&delta, "keyframe, return", 201, 900, CHECK_KEYFRAME_MS + 10, SCAN_DELTA_KEYFRAME);
+    fail |= check(&delta, "after the keyframe", 201, 900, CHECK_KEYFRAME_MS + 2000, SCAN_DELTA_SKIP);
+
+    // Bearings outside the span share the end bins
+    int clamp = scan_delta_bin(&delta, 100) != 0 || scan_delta_bin(&delta, 400) != SCAN_DELTA_MAX_BINS - 1 ||
+                scan_delta_bin(&delta, 360) != 180;
+    printf("%-36s %s\n", "bin clamp", clamp ? "FAIL" : "ok");
+    fail |= clamp;
+
+    // Static scene, 61 bearings a sweep at 2 s per sweep, +-10 mm noise
+    scan_delta_init(&delta, &cfg, 0);
+    uint32_t sent = 0, total = 0, rng = 1;
+    for (uint32_t sweep = 0; sweep < 300; sweep++)
+    {
+        for (int16_t angle = 180; angle <= 360; angle += 3)
+        {
+            rng = rng * 1103515245u + 12345u;
+            int32_t range_mm = angle < 270 ? 1500 + (int32_t)((rng >> 16) % 21) - 10 : -1;
+            sent += scan_delta_update(&delta, angle, range_mm, sweep * 2000) != SCAN_DELTA_SKIP;
+            total++;
+        }
+    }
+    printf("static scene: %lu of %lu sent (%.1fx less)\n", (unsigned long)sent, (unsigned long)total,
+           (double)total / sent);
+
+    // Keyframes and timed refreshes alone stay well under a tenth of the stream
+    if (sent > total / 10)
+        fail = 1;
+
+    printf(fail ? "FAIL\n" : "OK\n");
+    return fail;
+}
+
+#endif /* SCAN_DELTA_HOST_CHECK */
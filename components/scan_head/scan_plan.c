@@ -0,0 +1,188 @@
+/**
+ * @file scan_plan.c
+ *
+ * Scan head motion model, step/dwell planning and bearing sequencing.
+ *
+ * Has no ESP-IDF dependencies so it can be built, simulated and
+ * benchmarked on the host:
+ *
+ *     gcc -O2 -DSCAN_PLAN_HOST_CHECK -Icomponents/scan_head/include \
+ *         components/scan_head/scan_plan.c -o scan_plan_check
+ */
+#include "scan_plan.h"
+
+static uint32_t span_deg(const scan_plan_config_t *cfg)
+{
+    return cfg->end_deg > cfg->start_deg ? (uint32_t)(cfg->end_deg - cfg->start_deg) : 1;
+}
+
+uint32_t scan_motion_time_us(const scan_motion_t *motion, uint32_t step_deg)
+{
+    if (!step_deg)
+        return 0;
+
+    return motion->dead_us + motion->slew_us_per_deg * step_deg + motion->settle_us
+        + motion->settle_us_per_deg2 * step_deg * step_deg;
+}
+
+void scan_plan_optimize(scan_plan_t *plan, const scan_plan_config_t *cfg, const scan_motion_t *motion)
+{
+    uint32_t span = span_deg(cfg);
+    uint32_t max_step = cfg->resolution_deg ? cfg->resolution_deg : 1;
+    uint64_t best_sweep = UINT64_MAX;
+
+    if (max_step > span)
+        max_step = span;
+
+    for (uint32_t step = 1; step <= max_step; step++)
+    {
+        uint32_t move = scan_motion_time_us(motion, step);
+        uint32_t period = move + cfg->listen_us;
+        if (period < cfg->min_interval_us)
+            period = cfg->min_interval_us;
+
+        // Last step is clamped to the end of the sweep, it still costs a full period
+        uint64_t sweep = (uint64_t)((span + step - 1) / step) * period;
+        if (sweep < best_sweep)
+        {
+            best_sweep = sweep;
+            plan->step_deg = step;
+            plan->move_us = move;
+            plan->dwell_us = period - move;
+            plan->period_us = period;
+        }
+    }
+    plan->sweep_us = best_sweep > UINT32_MAX ? UINT32_MAX : (uint32_t)best_sweep;
+}
+
+void scan_seq_init(scan_seq_t *seq, const scan_plan_config_t *cfg, const scan_motion_t *motion, int64_t now_us)
+{
+    seq->cfg = *cfg;
+    seq->motion = *motion;
+    scan_plan_optimize(&seq->plan, cfg, motion);
+
+    // Head position unknown at power-up, allow for a full-span move. Long
+    // moves saturate, the per-step ringing term does not apply to them.
+    seq->bearing = cfg->start_deg;
+    seq->dir = 1;
+    seq->ready_us = now_us + motion->dead_us + motion->slew_us_per_deg * span_deg(cfg) + motion->settle_us;
+    seq->next_trig_us = now_us;
+}
+
+int64_t scan_seq_trigger_time(const scan_seq_t *seq)
+{
+    return seq->ready_us > seq->next_trig_us ? seq->ready_us : seq->next_trig_us;
+}
+
+int16_t scan_seq_advance(scan_seq_t *seq, int64_t trig_us, int64_t done_us, uint32_t gap_us)
+{
+    const scan_plan_config_t *cfg = &seq->cfg;
+
+    if (gap_us < cfg->min_interval_us)
+        gap_us = cfg->min_interval_us;
+    seq->next_trig_us = trig_us + gap_us;
+
+    if ((seq->dir > 0 && seq->bearing >= cfg->end_deg) || (seq->dir < 0 && seq->bearing <= cfg->start_deg))
+        seq->dir = -seq->dir;
+
+    int32_t next = seq->bearing + seq->dir * seq->plan.step_deg;
+    if (next > cfg->end_deg)
+        next = cfg->end_deg;
+    if (next < cfg->start_deg)
+        next = cfg->start_deg;
+
+    uint32_t step = next > seq->bearing ? (uint32_t)(next - seq->bearing) : (uint32_t)(seq->bearing - next);
+    seq->ready_us = done_us + scan_motion_time_us(&seq->motion, step);
+    seq->bearing = (int16_t)next;
+
+    return seq->bearing;
+}
+
+int64_t scan_seq_simulate(const scan_plan_config_t *cfg, const scan_motion_t *motion, uint32_t sweeps,
+                          uint32_t echo_us, uint32_t gap_us, uint32_t *bearings)
+{
+    scan_seq_t seq;
+    uint32_t count = 0;
+    uint32_t reversals = 0;
+    int8_t dir;
+
+    scan_seq_init(&seq, cfg, motion, 0);
+    dir = seq.dir;
+
+    int64_t now = 0;
+    while (reversals < sweeps)
+    {
+        int64_t trig = scan_seq_trigger_time(&seq);
+        now = trig + echo_us;
+        count++;
+        scan_seq_advance(&seq, trig, now, gap_us);
+        if (seq.dir != dir)
+        {
+            dir = seq.dir;
+            reversals++;
+        }
+    }
+
+    if (bearings)
+        *bearings = count;
+    return now;
+}
+
+#ifdef SCAN_PLAN_HOST_CHECK
+
+#include <stdio.h>
+
+// Firmware defaults, see main/radar_sensor.c
+#define CHECK_LISTEN_US   12200 // Trigger-to-echo latency plus the echo window for 2 m at 20 C
+#define CHECK_RINGDOWN_US 2000
+#define CHECK_SWEEPS      20
+
+// Sweep time against the plan for echoes from close in to a miss, plus
+// the 100 ms per bearing loop the sequencer replaced
+int main(void)
+{
+    static const uint32_t echoes_us[] = { 600, 3000, 6000, CHECK_LISTEN_US };
+    const scan_motion_t motion = {
+        .dead_us = 10000,
+        .slew_us_per_deg = 1700,
+        .settle_us = 5000,
+        .settle_us_per_deg2 = 200,
+    };
+    const scan_plan_config_t cfg = {
+        .start_deg = 180,
+        .end_deg = 360,
+        .resolution_deg = 3,
+        .listen_us = CHECK_LISTEN_US,
+        .min_interval_us = 3000,
+    };
+    scan_plan_t plan;
+    int fail = 0;
+
+    scan_plan_optimize(&plan, &cfg, &motion);
+    uint32_t per_sweep = (cfg.end_deg - cfg.start_deg + plan.step_deg - 1) / plan.step_deg;
+    printf("plan: %u deg steps, move %u us, dwell %u us, period %u us, sweep %u ms\n", plan.step_deg,
+           plan.move_us, plan.dwell_us, plan.period_us, plan.sweep_us / 1000);
+    printf("%8s %10s %10s %10s\n", "echo", "bearings", "sweep", "fixed");
+
+    int64_t prev = 0;
+    for (size_t i = 0; i < sizeof(echoes_us) / sizeof(echoes_us[0]); i++)
+    {
+        uint32_t bearings;
+        int64_t first = scan_seq_simulate(&cfg, &motion, 1, echoes_us[i], echoes_us[i] + CHECK_RINGDOWN_US, NULL);
+        int64_t total = scan_seq_simulate(&cfg, &motion, CHECK_SWEEPS + 1, echoes_us[i],
+                                          echoes_us[i] + CHECK_RINGDOWN_US, &bearings);
+        int64_t sweep = (total - first) / CHECK_SWEEPS;
+
+        // Every sweep covers the span at the planned step, no slower than
+        // planned, and a shorter echo never slows it down
+        if (bearings != (CHECK_SWEEPS + 1) * per_sweep + 1 || sweep > plan.sweep_us || (i && sweep < prev))
+            fail = 1;
+        prev = sweep;
+        printf("%5u us %10u %7.1f ms %7.1f ms\n", echoes_us[i], bearings, sweep / 1000.0, per_sweep * 100.0);
+    }
+
+    printf(fail ? "FAIL\n" : "OK\n");
+    return fail;
+}
+
+#endif /* SCAN_PLAN_HOST_CHECK */
@@ -0,0 +1,57 @@
+/**
+ * @file scan_servo.c
+ *
+ * Scan head servo on the LEDC peripheral
+ */
+#include "scan_servo.h"
+
+#define SERVO_FREQ_HZ 50
+#define SERVO_PERIOD_US (1000000 / SERVO_FREQ_HZ)
+#define SERVO_DUTY_BITS LEDC_TIMER_14_BIT
+#define SERVO_MODE LEDC_LOW_SPEED_MODE
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+
+esp_err_t scan_servo_init(const scan_servo_t *servo)
+{
+    CHECK_ARG(servo && servo->max_deg > servo->min_deg && servo->max_pulse_us > servo->min_pulse_us);
+
+    ledc_timer_config_t timer = {
+        .speed_mode = SERVO_MODE,
+        .duty_resolution = SERVO_DUTY_BITS,
+        .timer_num = servo->timer,
+        .freq_hz = SERVO_FREQ_HZ,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    CHECK(ledc_timer_config(&timer));
+
+    ledc_channel_config_t channel = {
+        .gpio_num = servo->gpio,
+        .speed_mode = SERVO_MODE,
+        .channel = servo->channel,
+        .intr_type = LEDC_INTR_DISABLE,
+        .timer_sel = servo->timer,
+        .duty = 0,
+        .hpoint = 0,
+    };
+    return ledc_channel_config(&channel);
+}
+
+esp_err_t scan_servo_set(const scan_servo_t *servo, int16_t bearing_deg)
+{
+    CHECK_ARG(servo);
+
+    if (bearing_deg < servo->min_deg)
+        bearing_deg = servo->min_deg;
+    if (bearing_deg > servo->max_deg)
+        bearing_deg = servo->max_deg;
+
+    uint32_t pulse_us = servo->min_pulse_us
+        + (uint32_t)(bearing_deg - servo->min_deg) * (servo->max_pulse_us - servo->min_pulse_us)
+        / (uint32_t)(servo->max_deg - servo->min_deg);
+    uint32_t duty = (pulse_us << SERVO_DUTY_BITS) / SERVO_PERIOD_US;
+
+    CHECK(ledc_set_duty(SERVO_MODE, servo->channel, duty));
+    return ledc_update_duty(SERVO_MODE, servo->channel);
+}
@@ -150,7 +150,8 @@ static esp_err_t ssd1351_set_addr_window(ssd1351_t *dev, uint16_t x0, uint16_t y
 
 esp_err_t ssd1351_init(ssd1351_t *dev, spi_host_device_t host,
                        gpio_num_t mosi_pin, gpio_num_t sclk_pin,
-                       gpio_num_t cs_pin, gpio_num_t dc_pin, gpio_num_t rst_pin) {
+                       gpio_num_t cs_pin, gpio_num_t dc_pin, gpio_num_t rst_pin,
+                       int clock_hz) {
     
     dev->dc_pin = dc_pin;
     dev->rst_pin = rst_pin;
@@ -185,7 +186,7 @@ esp_err_t ssd1351_init(ssd1351_t *dev, spi_host_device_t host,
     
     // Configure SPI device
     spi_device_interface_config_t dev_cfg = {
-        .clock_speed_hz = 1 * 1000 * 1000, // 1 MHz (Lowered for stability)
+        .clock_speed_hz = clock_hz ? clock_hz : SSD1351_DEFAULT_CLOCK_HZ,
         .mode = 0,
         .spics_io_num = cs_pin,
         .queue_size = 7,
@@ -383,6 +384,16 @@ esp_err_t ssd1351_draw_string(ssd1351_t *dev, uint16_t x, uint16_t y, const char
     return ESP_OK;
 }
 
+esp_err_t ssd1351_set_window(ssd1351_t *dev, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    if (x1 >= dev->width || y1 >= dev->height || x0 > x1 || y0 > y1) return ESP_ERR_INVALID_ARG;
+    
+    return ssd1351_set_addr_window(dev, x0, y0, x1, y1);
+}
+
+esp_err_t ssd1351_write_pixels(ssd1351_t *dev, const uint8_t *data, size_t len) {
+    return ssd1351_write_data(dev, data, len);
+}
+
 uint16_t ssd1351_color565(uint8_t r, uint8_t g, uint8_t b) {
     return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
 }
@@ -43,6 +43,9 @@
 #define SSD1351_WIDTH   128
 #define SSD1351_HEIGHT  128
 
+// SPI clock when none is given, lowered for stability on long wires
+#define SSD1351_DEFAULT_CLOCK_HZ (1 * 1000 * 1000)
+
 // Color definitions (16-bit RGB565 format)
 #define COLOR_BLACK     0x0000
 #define COLOR_WHITE     0xFFFF
@@ -72,11 +75,13 @@ typedef struct {
  * @param cs_pin CS GPIO pin
  * @param dc_pin DC (Data/Command) GPIO pin
  * @param rst_pin RST (Reset) GPIO pin
+ * @param clock_hz SPI clock, 0 for `SSD1351_DEFAULT_CLOCK_HZ`
  * @return esp_err_t ESP_OK on success
  */
 esp_err_t ssd1351_init(ssd1351_t *dev, spi_host_device_t host, 
                        gpio_num_t mosi_pin, gpio_num_t sclk_pin, 
-                       gpio_num_t cs_pin, gpio_num_t dc_pin, gpio_num_t rst_pin);
+                       gpio_num_t cs_pin, gpio_num_t dc_pin, gpio_num_t rst_pin,
+                       int clock_hz);
 
 /**
  * @brief Fill entire screen with one color
@@ -150,6 +155,28 @@ esp_err_t ssd1351_draw_char(ssd1351_t *dev, uint16_t x, uint16_t y, char c, uint
  */
 esp_err_t ssd1351_draw_string(ssd1351_t *dev, uint16_t x, uint16_t y, const char *str, uint16_t color, uint16_t bg);
 
+/**
+ * @brief Set the address window for the following pixel writes
+ * 
+ * @param dev Pointer to SSD1351 device structure
+ * @param x0 Start X coordinate
+ * @param y0 Start Y coordinate
+ * @param x1 End X coordinate (inclusive)
+ * @param y1 End Y coordinate (inclusive)
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t ssd1351_set_window(ssd1351_t *dev, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+/**
+ * @brief Write packed pixels into the current window
+ * 
+ * @param dev Pointer to SSD1351 device structure
+ * @param data RGB565 pixels, big-endian
+ * @param len Length in bytes
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t ssd1351_write_pixels(ssd1351_t *dev, const uint8_t *data, size_t len);
+
 /**
  * @brief Convert RGB888 to RGB565
  * 
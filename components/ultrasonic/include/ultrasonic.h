@@ -3,6 +3,8 @@
 
 #include <driver/gpio.h>
 #include <esp_err.h>
+#include "ultrasonic_conv.h"
+#include "ultrasonic_ping.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -68,6 +70,43 @@ esp_err_t ultrasonic_measure(const ultrasonic_sensor_t *dev, float max_distance,
  */
 esp_err_t ultrasonic_measure_cm(const ultrasonic_sensor_t *dev, uint32_t max_distance, uint32_t *distance);
 
+/**
+ * @brief Measure distance in millimeters using compensated speed of sound
+ *
+ * @param dev Pointer to the device descriptor
+ * @param conv Conversion factors, see ultrasonic_conv_init()
+ * @param max_distance Maximal distance to measure, millimeters
+ * @param[out] distance Distance in millimeters
+ * @return `ESP_OK` on success, otherwise:
+ *         - ::ESP_ERR_ULTRASONIC_PING         - Invalid state (previous ping is not ended)
+ *         - ::ESP_ERR_ULTRASONIC_PING_TIMEOUT - Device is not responding
+ *         - ::ESP_ERR_ULTRASONIC_ECHO_TIMEOUT - Distance is too big or wave is scattered
+ */
+esp_err_t ultrasonic_measure_mm(const ultrasonic_sensor_t *dev, const ultrasonic_conv_t *conv,
+                                uint32_t max_distance, uint32_t *distance);
+
+/**
+ * @brief Range-gated measurement
+ *
+ * Unlike ultrasonic_measure_raw(), an echo still in flight from the previous
+ * ping is waited out (up to the max gate) and the device is re-armed instead
+ * of failing, and echoes ending inside the min gate are skipped. The outcome
+ * of the ping is reported in `ping->status`.
+ *
+ * Echo edges are timestamped by a GPIO interrupt (the GPIO ISR service is
+ * installed if needed) and the calling task blocks between them, so
+ * interrupts are only disabled for the trigger pulse. One echo pin is
+ * measured at a time; call from a task, not from an ISR.
+ *
+ * @param dev Pointer to the device descriptor
+ * @param gate Range gate
+ * @param[out] ping Ping state and result
+ * @return `ESP_OK` when the ping completed, whatever its status,
+ *         otherwise a GPIO error
+ */
+esp_err_t ultrasonic_measure_gated(const ultrasonic_sensor_t *dev, const ultrasonic_gate_t *gate,
+                                   ultrasonic_ping_t *ping);
+
 #ifdef __cplusplus
 }
 #endif
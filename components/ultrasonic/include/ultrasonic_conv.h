@@ -0,0 +1,75 @@
+#ifndef __ULTRASONIC_CONV_H__
+#define __ULTRASONIC_CONV_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fixed-point precision of the conversion multipliers
+ */
+#define ULTRASONIC_CONV_SHIFT 16
+
+/**
+ * Round-trip time <-> distance conversion factors
+ *
+ * Both multipliers are Q16 and are derived from the speed of sound for the
+ * current environment by ultrasonic_conv_init(). Recompute them whenever the
+ * temperature or humidity input changes; the per-ping conversion is then a
+ * single multiply and shift.
+ */
+typedef struct
+{
+    uint32_t mm_per_us; //!< Distance per microsecond of round-trip time, mm, Q16
+    uint32_t us_per_mm; //!< Round-trip time per millimetre of distance, us, Q16
+} ultrasonic_conv_t;
+
+/**
+ * @brief Speed of sound in air
+ *
+ * @param temperature_c Air temperature, degrees Celsius
+ * @param humidity_pct Relative humidity, percent
+ * @return Speed of sound, m/s
+ */
+float ultrasonic_speed_of_sound(float temperature_c, float humidity_pct);
+
+/**
+ * @brief Precompute conversion factors for the given environment
+ *
+ * @param conv Pointer to the conversion descriptor
+ * @param temperature_c Air temperature, degrees Celsius
+ * @param humidity_pct Relative humidity, percent
+ */
+void ultrasonic_conv_init(ultrasonic_conv_t *conv, float temperature_c, float humidity_pct);
+
+/**
+ * @brief Convert echo round-trip time to distance
+ *
+ * @param conv Pointer to the conversion descriptor
+ * @param time_us Round-trip time, us
+ * @return Distance, mm
+ */
+static inline uint32_t ultrasonic_conv_us_to_mm(const ultrasonic_conv_t *conv, uint32_t time_us)
+{
+    return ((uint64_t)time_us * conv->mm_per_us + (1u << (ULTRASONIC_CONV_SHIFT - 1))) >> ULTRASONIC_CONV_SHIFT;
+}
+
+/**
+ * @brief Convert distance to echo round-trip time
+ *
+ * @param conv Pointer to the conversion descriptor
+ * @param distance_mm Distance, mm
+ * @return Round-trip time, us
+ */
+static inline uint32_t ultrasonic_conv_mm_to_us(const ultrasonic_conv_t *conv, uint32_t distance_mm)
+{
+    return ((uint64_t)distance_mm * conv->us_per_mm + (1u << (ULTRASONIC_CONV_SHIFT - 1))) >> ULTRASONIC_CONV_SHIFT;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ULTRASONIC_CONV_H__ */
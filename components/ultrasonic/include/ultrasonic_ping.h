@@ -0,0 +1,100 @@
+#ifndef __ULTRASONIC_PING_H__
+#define __ULTRASONIC_PING_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Per-ping result
+ */
+typedef enum
+{
+    ULTRASONIC_PING_OK = 0,  //!< Echo ended inside the range gate
+    ULTRASONIC_PING_NEAR,    //!< Only echoes shorter than the min gate (near-field clutter)
+    ULTRASONIC_PING_FAR,     //!< Echo still running at the max gate
+    ULTRASONIC_PING_NO_ECHO, //!< Echo line never went high, device is not responding
+    ULTRASONIC_PING_BUSY,    //!< Previous ping did not end within the max gate, not re-armed
+} ultrasonic_ping_status_t;
+
+/**
+ * Action requested by the timing state machine
+ */
+typedef enum
+{
+    ULTRASONIC_PING_ACT_WAIT = 0, //!< Keep sampling the echo line
+    ULTRASONIC_PING_ACT_TRIGGER,  //!< Send the trigger pulse, then keep sampling
+    ULTRASONIC_PING_ACT_DONE,     //!< Measurement finished, see `status`
+} ultrasonic_ping_action_t;
+
+/**
+ * Range gate, as start/stop windows on the echo time
+ */
+typedef struct
+{
+    uint32_t min_time_us;     //!< Echoes ending earlier are rejected as clutter
+    uint32_t max_time_us;     //!< Stop window, echo time is never longer than this
+    uint32_t rise_timeout_us; //!< Max time from trigger to the first rising edge
+} ultrasonic_gate_t;
+
+/**
+ * Timing state machine for one ping
+ *
+ * Fed with echo line edges (or samples), it drains an echo still in flight
+ * from the previous ping before re-arming, skips pulses ending inside the
+ * min gate and stops at the max gate. The echo time is the width of the
+ * accepted pulse, from its own rising edge to its falling edge; the stop
+ * window runs from the first rising edge.
+ */
+typedef struct
+{
+    ultrasonic_gate_t gate;
+    uint8_t state;
+    uint32_t t0;                     //!< Trigger time, or start of drain
+    uint32_t echo_ref;               //!< First rising edge, start of the stop window
+    uint32_t pulse_ref;              //!< Rising edge of the current pulse
+    uint32_t time_us;                //!< Echo time for `OK`, first rising edge to quiet line for `NEAR`, us
+    uint8_t rejected;                //!< Pulses rejected by the min gate
+    uint8_t rearmed;                 //!< 1 if the previous ping had to be drained first
+    ultrasonic_ping_status_t status; //!< Result once `ULTRASONIC_PING_ACT_DONE` is returned
+} ultrasonic_ping_t;
+
+/**
+ * @brief Start a ping
+ *
+ * @param ping Pointer to the ping state
+ * @param gate Range gate
+ * @param level Current echo line level
+ * @param now_us Current time, us
+ */
+void ultrasonic_ping_start(ultrasonic_ping_t *ping, const ultrasonic_gate_t *gate, int level, uint32_t now_us);
+
+/**
+ * @brief Feed one echo line sample
+ *
+ * @param ping Pointer to the ping state
+ * @param level Echo line level
+ * @param now_us Sample time, us
+ * @return Action the caller has to take
+ */
+ultrasonic_ping_action_t ultrasonic_ping_step(ultrasonic_ping_t *ping, int level, uint32_t now_us);
+
+/**
+ * @brief Time until the state machine times out without another edge
+ *
+ * Lets an edge-driven caller sleep instead of sampling the line: feed each
+ * edge with its timestamp, and the current level once this time is over.
+ *
+ * @param ping Pointer to the ping state
+ * @param now_us Current time, us
+ * @return us, 0 if a step is due now
+ */
+uint32_t ultrasonic_ping_wait_us(const ultrasonic_ping_t *ping, uint32_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ULTRASONIC_PING_H__ */
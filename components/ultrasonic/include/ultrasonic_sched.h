@@ -0,0 +1,79 @@
+#ifndef __ULTRASONIC_SCHED_H__
+#define __ULTRASONIC_SCHED_H__
+
+#include <stdint.h>
+#include "ultrasonic_conv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Adaptive ping scheduler configuration
+ */
+typedef struct
+{
+    uint32_t rise_us;         //!< Trigger to the echo line going high (burst and module latency), us
+    uint32_t ringdown_us;     //!< Transducer ring-down after the echo ends, us
+    uint32_t min_interval_us; //!< Lower bound between triggers, us
+    uint32_t max_interval_us; //!< Upper bound reached by timeout back-off, us
+    uint32_t max_range_mm;    //!< Range gate, echoes beyond it are not waited for
+} ultrasonic_sched_config_t;
+
+/**
+ * Adaptive ping scheduler state
+ *
+ * The interval is trigger to trigger and derived from the last round-trip
+ * time: a close target is re-triggered as soon as the trigger-to-echo
+ * latency, its echo and the transducer ring-down are over. Count it from
+ * the trigger time of the last ping, the round trip is already part of
+ * it. Consecutive timeouts double the interval up to `max_interval_us`.
+ */
+typedef struct
+{
+    ultrasonic_sched_config_t cfg;
+    uint32_t echo_window_us; //!< Longest echo accepted by the range gate, us
+    uint32_t interval_us;    //!< Last trigger to the next, us
+    uint8_t timeouts;        //!< Consecutive timeouts
+} ultrasonic_sched_t;
+
+/**
+ * @brief Init the scheduler
+ *
+ * Call again whenever the conversion factors change so the echo window
+ * follows the speed of sound.
+ *
+ * @param sched Pointer to the scheduler state
+ * @param cfg Scheduler configuration
+ * @param conv Conversion factors used to turn the range gate into time
+ */
+void ultrasonic_sched_init(ultrasonic_sched_t *sched, const ultrasonic_sched_config_t *cfg,
+                           const ultrasonic_conv_t *conv);
+
+/**
+ * @brief Account for a finished ping
+ *
+ * @param sched Pointer to the scheduler state
+ * @param time_us Time the echo line was busy, us; `echo_window_us` if
+ *                nothing answered inside the range gate
+ * @return Last trigger to the next, us
+ */
+uint32_t ultrasonic_sched_echo(ultrasonic_sched_t *sched, uint32_t time_us);
+
+/**
+ * @brief Account for a ping the sensor did not answer
+ *
+ * For a sensor that is not responding, or a miss while the head is not
+ * sweeping: the next ping would see the same thing, so the interval
+ * doubles with each consecutive timeout.
+ *
+ * @param sched Pointer to the scheduler state
+ * @return Last trigger to the next, us
+ */
+uint32_t ultrasonic_sched_timeout(ultrasonic_sched_t *sched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ULTRASONIC_SCHED_H__ */
@@ -12,6 +12,7 @@
 #include "ultrasonic.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
 #include <esp_timer.h>
 #include <esp32/rom/ets_sys.h>
 
@@ -20,6 +21,7 @@
 #define PING_TIMEOUT 6000
 #define ROUNDTRIP_M 5800.0f
 #define ROUNDTRIP_CM 58
+#define EDGE_QUEUE_LEN 16
 
 static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
 #define PORT_ENTER_CRITICAL portENTER_CRITICAL(&mux)
@@ -31,6 +33,17 @@ static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
 #define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
 #define RETURN_CRITICAL(RES) do { PORT_EXIT_CRITICAL; return RES; } while(0)
 
+// Echo line edge, timestamped in the ISR
+typedef struct
+{
+    uint32_t time_us;
+    uint8_t level;
+} echo_edge_t;
+
+// Gated measurements on one echo pin at a time
+static QueueHandle_t edge_queue;
+static gpio_num_t edge_pin = GPIO_NUM_NC;
+
 esp_err_t ultrasonic_init(const ultrasonic_sensor_t *dev)
 {
     CHECK_ARG(dev);
@@ -104,3 +117,102 @@ esp_err_t ultrasonic_measure_cm(const ultrasonic_sensor_t *dev, uint32_t max_dis
 
     return ESP_OK;
 }
+
+esp_err_t ultrasonic_measure_mm(const ultrasonic_sensor_t *dev, const ultrasonic_conv_t *conv,
+                                uint32_t max_distance, uint32_t *distance)
+{
+    CHECK_ARG(dev && conv && distance);
+
+    uint32_t time_us;
+    CHECK(ultrasonic_measure_raw(dev, ultrasonic_conv_mm_to_us(conv, max_distance), &time_us));
+    *distance = ultrasonic_conv_us_to_mm(conv, time_us);
+
+    return ESP_OK;
+}
+
+static void echo_isr(void *arg)
+{
+    echo_edge_t edge = {
+        .time_us = (uint32_t)esp_timer_get_time(),
+        .level = gpio_get_level((gpio_num_t)(intptr_t)arg),
+    };
+    BaseType_t woken = pdFALSE;
+
+    xQueueSendFromISR(edge_queue, &edge, &woken);
+    if (woken)
+        portYIELD_FROM_ISR();
+}
+
+static esp_err_t attach_echo_isr(gpio_num_t pin)
+{
+    if (edge_pin == pin)
+        return ESP_OK;
+
+    if (!edge_queue && !(edge_queue = xQueueCreate(EDGE_QUEUE_LEN, sizeof(echo_edge_t))))
+        return ESP_ERR_NO_MEM;
+
+    // Service may already be installed by someone else
+    esp_err_t res = gpio_install_isr_service(0);
+    if (res != ESP_OK && res != ESP_ERR_INVALID_STATE)
+        return res;
+    if (edge_pin != GPIO_NUM_NC)
+        gpio_isr_handler_remove(edge_pin);
+    CHECK(gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE));
+    CHECK(gpio_isr_handler_add(pin, echo_isr, (void *)(intptr_t)pin));
+    edge_pin = pin;
+
+    return ESP_OK;
+}
+
+static esp_err_t send_trigger(const ultrasonic_sensor_t *dev)
+{
+    esp_err_t res;
+
+    // Ping: Low for 2..4 us, then high 10 us; only the pulse itself runs with interrupts off
+    PORT_ENTER_CRITICAL;
+    if ((res = gpio_set_level(dev->trigger_pin, 0)) == ESP_OK)
+    {
+        ets_delay_us(TRIGGER_LOW_DELAY);
+        if ((res = gpio_set_level(dev->trigger_pin, 1)) == ESP_OK)
+        {
+            ets_delay_us(TRIGGER_HIGH_DELAY);
+            res = gpio_set_level(dev->trigger_pin, 0);
+        }
+    }
+    PORT_EXIT_CRITICAL;
+
+    return res;
+}
+
+esp_err_t ultrasonic_measure_gated(const ultrasonic_sensor_t *dev, const ultrasonic_gate_t *gate,
+                                   ultrasonic_ping_t *ping)
+{
+    CHECK_ARG(dev && gate && ping);
+    CHECK(attach_echo_isr(dev->echo_pin));
+
+    ultrasonic_ping_action_t act;
+    echo_edge_t edge;
+
+    // Edges left over from the previous ping are already accounted for by the level
+    xQueueReset(edge_queue);
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    ultrasonic_ping_start(ping, gate, gpio_get_level(dev->echo_pin), now);
+    act = ultrasonic_ping_step(ping, gpio_get_level(dev->echo_pin), now);
+
+    // Edges are timed in the ISR; the task sleeps between them and wakes
+    // for the gate timeouts, a tick late at worst
+    while (act != ULTRASONIC_PING_ACT_DONE)
+    {
+        if (act == ULTRASONIC_PING_ACT_TRIGGER)
+            CHECK(send_trigger(dev));
+
+        uint32_t wait_us = ultrasonic_ping_wait_us(ping, (uint32_t)esp_timer_get_time());
+        TickType_t ticks = pdMS_TO_TICKS((wait_us + 999) / 1000) + 1;
+        if (xQueueReceive(edge_queue, &edge, ticks) == pdTRUE)
+            act = ultrasonic_ping_step(ping, edge.level, edge.time_us);
+        else
+            act = ultrasonic_ping_step(ping, gpio_get_level(dev->echo_pin), (uint32_t)esp_timer_get_time());
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file ultrasonic_conv.c
+ *
+ * Fixed-point conversion between echo round-trip time and distance with
+ * temperature/humidity compensated speed of sound.
+ *
+ * Has no ESP-IDF dependencies so it can be built and checked on the host:
+ *
+ *     gcc -O2 -DULTRASONIC_CONV_HOST_CHECK -Icomponents/ultrasonic/include \
+ *         components/ultrasonic/ultrasonic_conv.c -lm -o conv_check
+ */
+#include "ultrasonic_conv.h"
+#include <math.h>
+
+// c = 331.4 + 0.606 * T + 0.0124 * RH (m/s), good to ~0.1% over 0..40 C
+#define SOUND_SPEED_0C      331.4f
+#define SOUND_SPEED_PER_C   0.606f
+#define SOUND_SPEED_PER_RH  0.0124f
+
+float ultrasonic_speed_of_sound(float temperature_c, float humidity_pct)
+{
+    return SOUND_SPEED_0C + SOUND_SPEED_PER_C * temperature_c + SOUND_SPEED_PER_RH * humidity_pct;
+}
+
+void ultrasonic_conv_init(ultrasonic_conv_t *conv, float temperature_c, float humidity_pct)
+{
+    // m/s == mm/ms, halve for the round trip: mm per us = c / 2000
+    double c = ultrasonic_speed_of_sound(temperature_c, humidity_pct);
+    double scale = (double)(1u << ULTRASONIC_CONV_SHIFT);
+
+    conv->mm_per_us = (uint32_t)lround(c / 2000.0 * scale);
+    conv->us_per_mm = (uint32_t)lround(2000.0 / c * scale);
+}
+
+#ifdef ULTRASONIC_CONV_HOST_CHECK
+
+#include <stdio.h>
+
+// Against a double-precision reference over the HC-SR04 range
+#define CHECK_MAX_MM      4000
+#define CHECK_MAX_ERR_MM  1.0
+#define CHECK_MAX_ERR_US  1.0
+
+int main(void)
+{
+    double worst_mm = 0, worst_us = 0;
+    float worst_mm_t = 0, worst_us_t = 0;
+
+    for (int t = -20; t <= 40; t += 5)
+    {
+        for (int rh = 0; rh <= 100; rh += 25)
+        {
+            ultrasonic_conv_t conv;
+            ultrasonic_conv_init(&conv, t, rh);
+            double c = SOUND_SPEED_0C + (double)SOUND_SPEED_PER_C * t + (double)SOUND_SPEED_PER_RH * rh;
+            uint32_t max_us = (uint32_t)(CHECK_MAX_MM * 2000.0 / c) + 1;
+
+            for (uint32_t us = 0; us <= max_us; us++)
+            {
+                double err = fabs(ultrasonic_conv_us_to_mm(&conv, us) - us * c / 2000.0);
+                if (err > worst_mm)
+                {
+                    worst_mm = err;
+                    worst_mm_t = t;
+                }
+            }
+            for (uint32_t mm = 0; mm <= CHECK_MAX_MM; mm++)
+            {
+                double err = fabs(ultrasonic_conv_mm_to_us(&conv, mm) - mm * 2000.0 / c);
+                if (err > worst_us)
+                {
+                    worst_us = err;
+                    worst_us_t = t;
+                }
+            }
+        }
+    }
+
+    printf("us -> mm: max error %.3f mm (at %.0f C)\n", worst_mm, worst_mm_t);
+    printf("mm -> us: max error %.3f us (at %.0f C)\n", worst_us, worst_us_t);
+    if (worst_mm > CHECK_MAX_ERR_MM || worst_us > CHECK_MAX_ERR_US)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
+
+#endif /* ULTRASONIC_CONV_HOST_CHECK */
@@ -0,0 +1,206 @@
+/**
+ * @file ultrasonic_ping.c
+ *
+ * Range-gated echo timing state machine.
+ *
+ * Has no ESP-IDF dependencies so it can be built and checked on the host:
+ *
+ *     gcc -O2 -DULTRASONIC_PING_HOST_CHECK -Icomponents/ultrasonic/include \
+ *         components/ultrasonic/ultrasonic_ping.c -o ping_check
+ */
+#include "ultrasonic_ping.h"
+
+enum
+{
+    STATE_DRAIN = 0, // Echo from the previous ping still high
+    STATE_ARM,       // Ready to trigger
+    STATE_WAIT_RISE, // Triggered, waiting for the first echo
+    STATE_ECHO,      // Echo line high
+    STATE_WAIT_NEXT, // Pulse rejected by the min gate, waiting for another
+    STATE_DONE,
+};
+
+static ultrasonic_ping_action_t finish(ultrasonic_ping_t *ping, ultrasonic_ping_status_t status)
+{
+    ping->state = STATE_DONE;
+    ping->status = status;
+    return ULTRASONIC_PING_ACT_DONE;
+}
+
+void ultrasonic_ping_start(ultrasonic_ping_t *ping, const ultrasonic_gate_t *gate, int level, uint32_t now_us)
+{
+    ping->gate = *gate;
+    ping->state = level ? STATE_DRAIN : STATE_ARM;
+    ping->t0 = now_us;
+    ping->echo_ref = 0;
+    ping->pulse_ref = 0;
+    ping->time_us = 0;
+    ping->rejected = 0;
+    ping->rearmed = level ? 1 : 0;
+    ping->status = ULTRASONIC_PING_NO_ECHO;
+}
+
+ultrasonic_ping_action_t ultrasonic_ping_step(ultrasonic_ping_t *ping, int level, uint32_t now_us)
+{
+    // Unsigned differences stay correct across timer wrap-around
+    switch (ping->state)
+    {
+        case STATE_DRAIN:
+            if (!level)
+            {
+                ping->state = STATE_WAIT_RISE;
+                ping->t0 = now_us;
+                return ULTRASONIC_PING_ACT_TRIGGER;
+            }
+            if (now_us - ping->t0 >= ping->gate.max_time_us)
+                return finish(ping, ULTRASONIC_PING_BUSY);
+            return ULTRASONIC_PING_ACT_WAIT;
+
+        case STATE_ARM:
+            ping->state = STATE_WAIT_RISE;
+            ping->t0 = now_us;
+            return ULTRASONIC_PING_ACT_TRIGGER;
+
+        case STATE_WAIT_RISE:
+            if (level)
+            {
+                ping->state = STATE_ECHO;
+                ping->echo_ref = now_us;
+                ping->pulse_ref = now_us;
+                return ULTRASONIC_PING_ACT_WAIT;
+            }
+            if (now_us - ping->t0 >= ping->gate.rise_timeout_us)
+                return finish(ping, ULTRASONIC_PING_NO_ECHO);
+            return ULTRASONIC_PING_ACT_WAIT;
+
+        case STATE_ECHO:
+        {
+            uint32_t width = now_us - ping->pulse_ref;
+            if (now_us - ping->echo_ref >= ping->gate.max_time_us)
+                return finish(ping, ULTRASONIC_PING_FAR);
+            if (level)
+                return ULTRASONIC_PING_ACT_WAIT;
+            if (width < ping->gate.min_time_us)
+            {
+                if (ping->rejected < UINT8_MAX)
+                    ping->rejected++;
+                // Line is quiet from here unless another pulse comes
+                ping->time_us = now_us - ping->echo_ref;
+                ping->state = STATE_WAIT_NEXT;
+                return ULTRASONIC_PING_ACT_WAIT;
+            }
+            ping->time_us = width;
+            return finish(ping, ULTRASONIC_PING_OK);
+        }
+
+        case STATE_WAIT_NEXT:
+            if (now_us - ping->echo_ref >= ping->gate.max_time_us)
+                return finish(ping, ULTRASONIC_PING_NEAR);
+            if (level)
+            {
+                ping->state = STATE_ECHO;
+                ping->pulse_ref = now_us;
+            }
+            return ULTRASONIC_PING_ACT_WAIT;
+
+        default:
+            return ULTRASONIC_PING_ACT_DONE;
+    }
+}
+
+static uint32_t time_left(uint32_t since, uint32_t len, uint32_t now_us)
+{
+    uint32_t elapsed = now_us - since;
+    return elapsed >= len ? 0 : len - elapsed;
+}
+
+uint32_t ultrasonic_ping_wait_us(const ultrasonic_ping_t *ping, uint32_t now_us)
+{
+    switch (ping->state)
+    {
+        case STATE_DRAIN:
+            return time_left(ping->t0, ping->gate.max_time_us, now_us);
+        case STATE_WAIT_RISE:
+            return time_left(ping->t0, ping->gate.rise_timeout_us, now_us);
+        case STATE_ECHO:
+        case STATE_WAIT_NEXT:
+            return time_left(ping->echo_ref, ping->gate.max_time_us, now_us);
+        default:
+            return 0;
+    }
+}
+
+#ifdef ULTRASONIC_PING_HOST_CHECK
+
+#include <stdio.h>
+
+typedef struct
+{
+    const char *name;
+    int level;                    //!< Echo line level at start
+    uint32_t edges[4];            //!< Edge times, us, alternating from `level`, 0 ends the list
+    ultrasonic_ping_status_t status;
+    uint32_t time_us;
+} check_case_t;
+
+// Edge-driven like ultrasonic_measure_gated(): steps on each edge, and on
+// the current level once ultrasonic_ping_wait_us() runs out
+static ultrasonic_ping_t run(const ultrasonic_gate_t *gate, const check_case_t *c)
+{
+    ultrasonic_ping_t ping;
+    uint32_t now = 0;
+    int level = c->level;
+    int next = 0;
+
+    ultrasonic_ping_start(&ping, gate, level, now);
+    ultrasonic_ping_action_t act = ultrasonic_ping_step(&ping, level, now);
+    while (act != ULTRASONIC_PING_ACT_DONE)
+    {
+        uint32_t wait = ultrasonic_ping_wait_us(&ping, now);
+        if (next < 4 && c->edges[next] && c->edges[next] <= now + wait)
+        {
+            now = c->edges[next++];
+            level = !level;
+        }
+        else
+            now += wait;
+        act = ultrasonic_ping_step(&ping, level, now);
+    }
+    return ping;
+}
+
+int main(void)
+{
+    static const char *const names[] = { "ok", "near", "far", "no-echo", "busy" };
+    const ultrasonic_gate_t gate = {
+        .min_time_us = 175,    // 30 mm
+        .max_time_us = 11623,  // 2 m
+        .rise_timeout_us = 6000,
+    };
+    const check_case_t cases[] = {
+        { "target at 1 m", 0, { 500, 6312 }, ULTRASONIC_PING_OK, 5812 },
+        { "clutter, then 0.5 m", 0, { 500, 600, 3000, 5906 }, ULTRASONIC_PING_OK, 2906 },
+        { "clutter only", 0, { 500, 600 }, ULTRASONIC_PING_NEAR, 100 },
+        { "nothing in range", 0, { 500 }, ULTRASONIC_PING_FAR, 0 },
+        { "not responding", 0, { 0 }, ULTRASONIC_PING_NO_ECHO, 0 },
+        { "drain, then 0.3 m", 1, { 3000, 3500, 5243 }, ULTRASONIC_PING_OK, 1743 },
+        { "stuck high", 1, { 0 }, ULTRASONIC_PING_BUSY, 0 },
+    };
+    int fail = 0;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const check_case_t *c = &cases[i];
+        ultrasonic_ping_t ping = run(&gate, c);
+        int ok = ping.status == c->status
+            && (c->status != ULTRASONIC_PING_OK && c->status != ULTRASONIC_PING_NEAR ? 1 : ping.time_us == c->time_us);
+        fail |= !ok;
+        printf("%-20s %-8s %6u us, %u rejected, rearmed %u  %s\n", c->name, names[ping.status], ping.time_us,
+               ping.rejected, ping.rearmed, ok ? "ok" : "FAIL");
+    }
+
+    printf(fail ? "FAIL\n" : "OK\n");
+    return fail;
+}
+
+#endif /* ULTRASONIC_PING_HOST_CHECK */
@@ -0,0 +1,136 @@
+/**
+ * @file ultrasonic_sched.c
+ *
+ * Adaptive ping rate: trigger-to-trigger interval from the last round-trip
+ * time, exponential back-off on timeouts.
+ *
+ * Has no ESP-IDF dependencies so it can be built and checked on the host:
+ *
+ *     gcc -O2 -Wall -Wextra -DULTRASONIC_SCHED_HOST_CHECK -Icomponents/ultrasonic/include \
+ *         components/ultrasonic/ultrasonic_sched.c components/ultrasonic/ultrasonic_conv.c \
+ *         -lm -o sched_check
+ */
+#include "ultrasonic_sched.h"
+
+// Back-off stops doubling after this many consecutive timeouts
+#define MAX_BACKOFF_SHIFT 5
+
+static uint32_t clamp_interval(const ultrasonic_sched_t *sched, uint32_t interval_us)
+{
+    if (interval_us < sched->cfg.min_interval_us)
+        return sched->cfg.min_interval_us;
+    if (interval_us > sched->cfg.max_interval_us)
+        return sched->cfg.max_interval_us;
+    return interval_us;
+}
+
+// Trigger until the line is quiet again and the transducer has stopped ringing
+static uint32_t busy_us(const ultrasonic_sched_t *sched, uint32_t time_us)
+{
+    return sched->cfg.rise_us + time_us + sched->cfg.ringdown_us;
+}
+
+void ultrasonic_sched_init(ultrasonic_sched_t *sched, const ultrasonic_sched_config_t *cfg,
+                           const ultrasonic_conv_t *conv)
+{
+    sched->cfg = *cfg;
+    sched->echo_window_us = ultrasonic_conv_mm_to_us(conv, cfg->max_range_mm);
+    sched->timeouts = 0;
+    sched->interval_us = clamp_interval(sched, busy_us(sched, sched->echo_window_us));
+}
+
+uint32_t ultrasonic_sched_echo(ultrasonic_sched_t *sched, uint32_t time_us)
+{
+    // The round trip is part of the interval, it is counted from the trigger
+    sched->timeouts = 0;
+    sched->interval_us = clamp_interval(sched, busy_us(sched, time_us));
+
+    return sched->interval_us;
+}
+
+uint32_t ultrasonic_sched_timeout(ultrasonic_sched_t *sched)
+{
+    uint8_t shift = sched->timeouts < MAX_BACKOFF_SHIFT ? sched->timeouts : MAX_BACKOFF_SHIFT;
+    uint64_t interval = (uint64_t)busy_us(sched, sched->echo_window_us) << shift;
+
+    if (sched->timeouts < UINT8_MAX)
+        sched->timeouts++;
+    sched->interval_us = clamp_interval(sched, interval > UINT32_MAX ? UINT32_MAX : (uint32_t)interval);
+
+    return sched->interval_us;
+}
+
+#ifdef ULTRASONIC_SCHED_HOST_CHECK
+
+#include <stdio.h>
+
+#define CHECK_TIMEOUTS 8
+
+// Simulated echoes: pings per second for a target at each range, against
+// the fixed 100 ms loop this replaced and against waiting the interval
+// again after the echo has ended. Then a run of timeouts, which has to
+// back off to the cap and recover on the next echo
+int main(void)
+{
+    static const uint32_t ranges_mm[] = { 50, 150, 300, 500, 1000, 1500, 2000 };
+    const ultrasonic_sched_config_t cfg = {
+        .rise_us = 500,
+        .ringdown_us = 2000,
+        .min_interval_us = 3000,
+        .max_interval_us = 250000,
+        .max_range_mm = 2000,
+    };
+    ultrasonic_conv_t conv;
+    ultrasonic_sched_t sched;
+    int fail = 0;
+
+    ultrasonic_conv_init(&conv, 20.0f, 50.0f);
+    ultrasonic_sched_init(&sched, &cfg, &conv);
+    printf("echo window %u us, floor %u us, cap %u us\n", sched.echo_window_us, cfg.min_interval_us,
+           cfg.max_interval_us);
+    printf("%8s %8s %10s %10s %10s %10s\n", "range", "echo", "interval", "pings/s", "after-echo", "fixed");
+
+    for (size_t i = 0; i < sizeof(ranges_mm) / sizeof(ranges_mm[0]); i++)
+    {
+        uint32_t echo = ultrasonic_conv_mm_to_us(&conv, ranges_mm[i]);
+        uint32_t interval = ultrasonic_sched_echo(&sched, echo);
+
+        // The next burst must not go out before this echo has started, ended
+        // and rung down
+        if (interval < cfg.rise_us + echo + cfg.ringdown_us || interval < cfg.min_interval_us)
+            fail = 1;
+        printf("%6u mm %5u us %7u us %10.1f %10.1f %10.1f\n", ranges_mm[i], echo, interval,
+               1e6 / interval, 1e6 / (echo + interval), 10.0);
+    }
+
+    uint32_t miss = ultrasonic_sched_echo(&sched, sched.echo_window_us);
+    printf("%9s %5u us %7u us %10.1f\n", "miss", sched.echo_window_us, miss, 1e6 / miss);
+
+    // Doubles from a full miss, never shrinks, stops at the cap
+    uint32_t prev = 0;
+    for (int i = 0; i < CHECK_TIMEOUTS; i++)
+    {
+        uint32_t interval = ultrasonic_sched_timeout(&sched);
+        uint32_t expect = i ? prev * 2 : miss;
+
+        if (expect > cfg.max_interval_us)
+            expect = cfg.max_interval_us;
+        if (interval != expect || interval < prev)
+            fail = 1;
+        printf("%6s %2d %8s %7u us %10.1f\n", "timeout", i + 1, "", interval, 1e6 / interval);
+        prev = interval;
+    }
+    if (prev != cfg.max_interval_us)
+        fail = 1;
+
+    uint32_t echo = ultrasonic_conv_mm_to_us(&conv, 500);
+    uint32_t back = ultrasonic_sched_echo(&sched, echo);
+    if (back != cfg.rise_us + echo + cfg.ringdown_us || ultrasonic_sched_timeout(&sched) != miss)
+        fail = 1;
+    printf("%9s %5u us %7u us %10.1f\n", "recovered", echo, back, 1e6 / back);
+
+    printf(fail ? "FAIL\n" : "OK\n");
+    return fail;
+}
+
+#endif /* ULTRASONIC_SCHED_HOST_CHECK */
@@ -0,0 +1,115 @@
+#ifndef __UPLINK_H__
+#define __UPLINK_H__
+
+#include <stdbool.h>
+#include <esp_err.h>
+#include "uplink_encode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Number of preallocated transmit buffers
+ */
+#define UPLINK_POOL_SIZE 8
+
+/**
+ * Size of one transmit buffer, bytes. Also the UDP datagram size, kept
+ * below the 1472 byte payload of a 1500 byte MTU.
+ */
+#define UPLINK_BUF_SIZE 1400
+
+/**
+ * Max time a sample waits in a partly filled UDP datagram, ms
+ */
+#define UPLINK_UDP_FLUSH_MS 50
+
+/**
+ * Default backlog drain rate after reconnecting, samples per second
+ */
+#define UPLINK_DRAIN_PER_SEC 50
+
+/**
+ * Uplink transport
+ */
+typedef enum
+{
+    UPLINK_TRANSPORT_HTTP = 0, //!< One JSON POST per sample over keep-alive TCP
+    UPLINK_TRANSPORT_UDP,      //!< Binary datagrams, as many samples as fit, no retransmits
+} uplink_transport_t;
+
+/**
+ * Uplink configuration
+ */
+typedef struct
+{
+    uplink_transport_t transport;
+    const char *url;        //!< HTTP: server endpoint samples are POSTed to
+    const char *host;       //!< UDP: server IPv4 address
+    uint16_t port;          //!< UDP: server port
+    uint32_t device_id;     //!< Device identifier, 0 to derive it from the WiFi MAC
+    uint32_t drain_per_sec; //!< Backlog drain rate, 0 for `UPLINK_DRAIN_PER_SEC`
+} uplink_config_t;
+
+/**
+ * Uplink counters
+ */
+typedef struct
+{
+    uint32_t sent;           //!< Samples delivered
+    uint32_t drained;        //!< Samples sent from the offline backlog
+    uint32_t dropped;        //!< Samples diverted to the backlog because no buffer was free
+    uint32_t failed;         //!< Transport errors, HTTP samples are kept in the backlog
+    uint32_t stored_dropped; //!< Samples lost because the backlog was full
+    uint32_t first_sent_ms;  //!< Boot to the first delivered sample, 0 until then
+} uplink_stats_t;
+
+/**
+ * @brief Init the uplink and start its transmit task
+ *
+ * All transmit buffers are allocated statically; submitting a sample does
+ * not touch the heap. Samples left in the flash backlog by a previous boot
+ * are sent once the network is up. Requires NVS to be initialized.
+ *
+ * @param cfg Uplink configuration, strings must outlive the uplink
+ * @return `ESP_OK` on success
+ */
+esp_err_t uplink_init(const uplink_config_t *cfg);
+
+/**
+ * @brief Queue a sample for transmission
+ *
+ * Stamps the sample with boot counter, sequence number and time, then
+ * serializes it directly into a free transmit buffer which is handed to the
+ * transmit task and recycled once written to the socket. With UDP the
+ * buffer stays open for further samples until it is full or its oldest
+ * sample is `UPLINK_UDP_FLUSH_MS` old. Never waits for the network.
+ * Must be called from a single task.
+ *
+ * @param sample Sample to send, `seq`, `timestamp_ms` and `boot` are ignored
+ * @return `ESP_OK` on success, otherwise the sample went to the backlog:
+ *         - `ESP_ERR_INVALID_STATE` - Network is down
+ *         - `ESP_ERR_NO_MEM`        - No free transmit buffer
+ */
+esp_err_t uplink_submit(const uplink_sample_t *sample);
+
+/**
+ * @brief Report network connectivity
+ *
+ * @param connected true once an IP address was obtained
+ */
+void uplink_set_connected(bool connected);
+
+/**
+ * @brief Get a consistent copy of the uplink counters, callable from any task
+ *
+ * @param[out] stats Counters
+ */
+void uplink_get_stats(uplink_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UPLINK_H__ */
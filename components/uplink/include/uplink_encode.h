@@ -0,0 +1,97 @@
+#ifndef __UPLINK_ENCODE_H__
+#define __UPLINK_ENCODE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * UDP datagram header: magic, version, sample count, device id, boot
+ * counter, datagram sequence number and send time, all little-endian
+ */
+#define UPLINK_DGRAM_MAGIC       0x5244 // "RD"
+#define UPLINK_DGRAM_VERSION     1
+#define UPLINK_DGRAM_HEADER_SIZE 20
+
+/**
+ * Packed size of one sample in a datagram
+ */
+#define UPLINK_DGRAM_SAMPLE_SIZE 16
+
+/**
+ * One radar sample as sent to the server
+ */
+typedef struct
+{
+    uint32_t seq;          //!< Sequence number, per boot
+    uint32_t timestamp_ms; //!< Time since boot, ms
+    uint16_t boot;         //!< Boot counter, makes (boot, seq) unique per device
+    int16_t angle;         //!< Bearing, degrees
+    int32_t distance_mm;   //!< Range, mm, negative when nothing was detected
+} uplink_sample_t;
+
+/**
+ * @brief Serialize a sample as JSON straight into a transmit buffer
+ *
+ * Produces `{"angle":270,"distance":45.3,"dev":7,"boot":3,"seq":1042,"ts":98120}`
+ * with the distance in centimetres, without going through printf.
+ *
+ * @param buf Destination buffer
+ * @param size Size of the destination buffer
+ * @param sample Sample to encode
+ * @param device_id Device identifier
+ * @return Encoded length, 0 if it does not fit
+ */
+size_t uplink_encode_json(char *buf, size_t size, const uplink_sample_t *sample, uint32_t device_id);
+
+/**
+ * @brief Start a UDP datagram
+ *
+ * @param buf Destination buffer, at least `UPLINK_DGRAM_HEADER_SIZE` bytes
+ * @param device_id Device identifier
+ * @param boot Boot counter
+ * @return Datagram length so far
+ */
+size_t uplink_dgram_begin(char *buf, uint32_t device_id, uint16_t boot);
+
+/**
+ * @brief Append a sample to a UDP datagram
+ *
+ * @param buf Datagram started with uplink_dgram_begin()
+ * @param len Datagram length so far
+ * @param size Size of the buffer
+ * @param sample Sample to append
+ * @return New datagram length, 0 if the sample does not fit
+ */
+size_t uplink_dgram_append(char *buf, size_t len, size_t size, const uplink_sample_t *sample);
+
+/**
+ * @brief Stamp a UDP datagram right before sending it
+ *
+ * @param buf Datagram started with uplink_dgram_begin()
+ * @param seq Datagram sequence number
+ * @param timestamp_ms Send time since boot, ms
+ */
+void uplink_dgram_finish(char *buf, uint32_t seq, uint32_t timestamp_ms);
+
+/**
+ * @brief Read a sample back from a UDP datagram
+ *
+ * Lets the sender return the samples of an unsent datagram to the backlog.
+ *
+ * @param buf Datagram started with uplink_dgram_begin()
+ * @param len Datagram length
+ * @param index Sample index, from 0
+ * @param[out] sample Decoded sample
+ * @return 0 on success, -1 if there is no such sample
+ */
+int uplink_dgram_sample(const char *buf, size_t len, unsigned index, uplink_sample_t *sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UPLINK_ENCODE_H__ */
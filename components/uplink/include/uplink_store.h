@@ -0,0 +1,158 @@
+#ifndef __UPLINK_STORE_H__
+#define __UPLINK_STORE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "uplink_encode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Samples held in RAM before spilling to flash
+ */
+#define UPLINK_STORE_RAM_SIZE 128
+
+/**
+ * Samples moved to flash at once
+ */
+#define UPLINK_STORE_SPILL 32
+
+/**
+ * RAM ring fill at which the oldest `UPLINK_STORE_SPILL` samples are
+ * handed to flash, leaves headroom while the spill is pending
+ */
+#define UPLINK_STORE_SPILL_AT (UPLINK_STORE_RAM_SIZE - 2 * UPLINK_STORE_SPILL)
+
+/**
+ * Flash region backing the store
+ *
+ * Callbacks return 0 on success. `erase` is always called with sector
+ * aligned offset and length.
+ */
+typedef struct
+{
+    void *ctx;
+    uint32_t size;        //!< Region size, bytes, multiple of `sector_size`
+    uint32_t sector_size; //!< Erase unit, bytes
+    int (*read)(void *ctx, uint32_t offset, void *dst, uint32_t len);
+    int (*write)(void *ctx, uint32_t offset, const void *src, uint32_t len);
+    int (*erase)(void *ctx, uint32_t offset, uint32_t len);
+} uplink_flash_t;
+
+/**
+ * Store-and-forward queue
+ *
+ * A RAM ring that spills its oldest samples into an append-only log on
+ * flash. The log is written sector by sector in a circle and a sector is
+ * erased as soon as it has been drained, so erases are spread evenly over
+ * the region. When the log is full the oldest sector is discarded.
+ *
+ * Draining returns the oldest sample first. Each drained record is marked
+ * on flash, so a reboot resumes after the last sample taken.
+ *
+ * The RAM ring calls (push, take_spill, pop_ram) and the log calls (spill,
+ * pop_log) touch separate state. With one producer task and one draining
+ * task, only the RAM ring calls need a lock, and flash writes and erases
+ * never hold up the producer.
+ */
+typedef struct
+{
+    uplink_sample_t ram[UPLINK_STORE_RAM_SIZE];
+    uint16_t ram_head; //!< Oldest sample
+    uint16_t ram_count;
+
+    const uplink_flash_t *flash; //!< NULL for a RAM-only store
+    uint32_t sectors;
+    uint32_t gen;         //!< Generation of the head sector
+    uint32_t head_sector; //!< Sector being appended to
+    uint32_t head_rec;    //!< Next free record in the head sector
+    uint32_t tail_sector; //!< Sector being drained
+    uint32_t tail_rec;    //!< Next record to drain in the tail sector
+
+    uint32_t ram_dropped; //!< Samples discarded because the RAM ring filled before it was spilled
+    uint32_t dropped;     //!< Samples discarded because the log was full or unusable
+} uplink_store_t;
+
+/**
+ * @brief Init the store, recovering samples left on flash
+ *
+ * @param store Pointer to the store
+ * @param flash Flash region, NULL for a RAM-only store
+ * @return 0 on success, -1 on flash error (the store is then RAM-only)
+ */
+int uplink_store_init(uplink_store_t *store, const uplink_flash_t *flash);
+
+/**
+ * @brief Append a sample to the RAM ring
+ *
+ * Never touches flash. When the ring is full the oldest sample is lost;
+ * the draining task keeps it below that with take_spill() and spill().
+ *
+ * @param store Pointer to the store
+ * @param sample Sample to keep
+ */
+void uplink_store_push(uplink_store_t *store, const uplink_sample_t *sample);
+
+/**
+ * @brief Take the oldest samples off the RAM ring once it is filling up
+ *
+ * @param store Pointer to the store
+ * @param[out] batch Up to `UPLINK_STORE_SPILL` samples, to be passed to spill()
+ * @return Number of samples taken, 0 below `UPLINK_STORE_SPILL_AT`
+ */
+uint32_t uplink_store_take_spill(uplink_store_t *store, uplink_sample_t *batch);
+
+/**
+ * @brief Append samples taken by take_spill() to the flash log
+ *
+ * Call before the next pop so the order is kept. Without flash the samples
+ * are counted as dropped.
+ *
+ * @param store Pointer to the store
+ * @param batch Samples, oldest first
+ * @param count Number of samples
+ */
+void uplink_store_spill(uplink_store_t *store, const uplink_sample_t *batch, uint32_t count);
+
+/**
+ * @brief Take the oldest sample from the flash log
+ *
+ * @param store Pointer to the store
+ * @param[out] sample Oldest sample
+ * @return true if a sample was returned, false if the log is empty
+ */
+bool uplink_store_pop_log(uplink_store_t *store, uplink_sample_t *sample);
+
+/**
+ * @brief Take the oldest sample from the RAM ring
+ *
+ * @param store Pointer to the store
+ * @param[out] sample Oldest sample
+ * @return true if a sample was returned, false if the ring is empty
+ */
+bool uplink_store_pop_ram(uplink_store_t *store, uplink_sample_t *sample);
+
+/**
+ * @brief Take the oldest sample, log first
+ *
+ * @param store Pointer to the store
+ * @param[out] sample Oldest sample
+ * @return true if a sample was returned, false if the store is empty
+ */
+bool uplink_store_pop(uplink_store_t *store, uplink_sample_t *sample);
+
+/**
+ * @brief Check whether anything is waiting
+ *
+ * @param store Pointer to the store
+ * @return true if the store is empty
+ */
+bool uplink_store_empty(const uplink_store_t *store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UPLINK_STORE_H__ */
@@ -0,0 +1,569 @@
+/**
+ * @file uplink.c
+ *
+ * Sample uplink to the dashboard server, either as JSON POSTs over a
+ * persistent HTTP connection or as binary UDP datagrams.
+ *
+ * Samples are encoded by the producer straight into one of a fixed pool of
+ * transmit buffers. Buffer indices travel through two queues: free -> tx
+ * (producer) and tx -> free (transmit task, after the socket write), so a
+ * sample is never copied after encoding and nothing is allocated per sample.
+ * With UDP the producer keeps appending to its open buffer until it is full;
+ * the transmit task flushes it once it is old enough or the link goes down.
+ *
+ * While the network is down, or no buffer is free, samples go to a
+ * store-and-forward queue (RAM ring spilling to the `radarlog` partition)
+ * which the transmit task drains at a limited rate after reconnecting.
+ *
+ * To confirm on the target that submitting and sending allocate nothing,
+ * enable CONFIG_HEAP_TRACING_STANDALONE, call
+ * heap_trace_init_standalone() with a 100-record buffer, and bracket a few
+ * thousand uplink_submit() calls with heap_trace_start(HEAP_TRACE_ALL)
+ * and heap_trace_stop(). heap_trace_dump() must then show no callers
+ * from this file. lwIP pbufs allocated inside send() are freed once
+ * transmitted, and a HEAP_TRACE_LEAKS run over the same window reports
+ * none of them. Outside a trace, the heap line of radar_sensor's periodic
+ * stats log should stay flat.
+ */
+#include "uplink.h"
+#include "uplink_store.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <esp_http_client.h>
+#include <esp_partition.h>
+#include <spi_flash_mmap.h>
+#include <esp_timer.h>
+#include <esp_log.h>
+#include <esp_mac.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <nvs.h>
+#include <lwip/sockets.h>
+
+#define UPLINK_TASK_STACK 4096
+#define UPLINK_TASK_PRIO  4
+
+#define UPLINK_PARTITION_TYPE    0x40 // Custom data subtype of the `radarlog` partition
+#define UPLINK_PARTITION_LABEL   "radarlog"
+#define UPLINK_NVS_NAMESPACE     "uplink"
+
+static const char *TAG = "uplink";
+
+typedef struct
+{
+    uint16_t len;
+    uint8_t count;          //!< UDP: samples in the datagram
+    uplink_sample_t sample; //!< HTTP: kept to re-queue the sample if it is not sent
+    char data[UPLINK_BUF_SIZE];
+} uplink_buf_t;
+
+static uplink_buf_t s_pool[UPLINK_POOL_SIZE];
+
+static StaticQueue_t s_free_q_buf, s_tx_q_buf;
+static uint8_t s_free_q_storage[UPLINK_POOL_SIZE], s_tx_q_storage[UPLINK_POOL_SIZE];
+static QueueHandle_t s_free_q, s_tx_q;
+
+static uplink_store_t s_store;
+static uplink_flash_t s_flash;
+static StaticSemaphore_t s_store_lock_buf;
+static SemaphoreHandle_t s_store_lock;
+
+static uplink_transport_t s_transport;
+static uint32_t s_device_id;
+static esp_http_client_handle_t s_client;
+static struct sockaddr_in s_udp_addr;
+static int s_sock = -1; //!< Opened by uplink_task once the network is up
+static uint32_t s_dgram_seq;
+
+// Datagram being filled by the producer, UDP only
+static StaticSemaphore_t s_open_lock_buf;
+static SemaphoreHandle_t s_open_lock;
+static int s_open_idx = -1;
+static TickType_t s_open_since;
+
+static volatile bool s_connected;
+static uint16_t s_boot;
+static uint32_t s_seq;
+static uint32_t s_drain_per_sec;
+static uplink_stats_t s_stats;
+static uint32_t s_first_sent_ms;
+// Written by uplink_task and the producer, read from any task
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void stats_add(uint32_t *counter, uint32_t n)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *counter += n;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static int flash_read(void *ctx, uint32_t offset, void *dst, uint32_t len)
+{
+    return esp_partition_read(ctx, offset, dst, len) == ESP_OK ? 0 : -1;
+}
+
+static int flash_write(void *ctx, uint32_t offset, const void *src, uint32_t len)
+{
+    return esp_partition_write(ctx, offset, src, len) == ESP_OK ? 0 : -1;
+}
+
+static int flash_erase(void *ctx, uint32_t offset, uint32_t len)
+{
+    return esp_partition_erase_range(ctx, offset, len) == ESP_OK ? 0 : -1;
+}
+
+static void store_push(const uplink_sample_t *sample)
+{
+    xSemaphoreTake(s_store_lock, portMAX_DELAY);
+    uplink_store_push(&s_store, sample);
+    xSemaphoreGive(s_store_lock);
+}
+
+// Moves the oldest samples from RAM to flash, uplink_task only so the
+// producer never waits on a flash write or erase
+static void store_spill(void)
+{
+    static uplink_sample_t batch[UPLINK_STORE_SPILL];
+
+    xSemaphoreTake(s_store_lock, portMAX_DELAY);
+    uint32_t count = uplink_store_take_spill(&s_store, batch);
+    uint32_t ram_dropped = s_store.ram_dropped;
+    xSemaphoreGive(s_store_lock);
+
+    uplink_store_spill(&s_store, batch, count);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats.stored_dropped = s_store.dropped + ram_dropped;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+// uplink_task only, the log is not shared with the producer
+static bool store_pop(uplink_sample_t *sample)
+{
+    if (uplink_store_pop_log(&s_store, sample))
+        return true;
+
+    xSemaphoreTake(s_store_lock, portMAX_DELAY);
+    bool res = uplink_store_pop_ram(&s_store, sample);
+    xSemaphoreGive(s_store_lock);
+    return res;
+}
+
+static void load_boot_counter(void)
+{
+    nvs_handle_t nvs;
+
+    if (nvs_open(UPLINK_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "NVS unavailable, boot counter stays at 0");
+        return;
+    }
+    nvs_get_u16(nvs, "boot", &s_boot);
+    s_boot++;
+    nvs_set_u16(nvs, "boot", s_boot);
+    nvs_commit(nvs);
+    nvs_close(nvs);
+}
+
+static void init_store(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, UPLINK_PARTITION_TYPE,
+                                                           UPLINK_PARTITION_LABEL);
+    if (part)
+    {
+        s_flash = (uplink_flash_t) {
+            .ctx = (void *)part,
+            .size = part->size - part->size % SPI_FLASH_SEC_SIZE,
+            .sector_size = SPI_FLASH_SEC_SIZE,
+            .read = flash_read,
+            .write = flash_write,
+            .erase = flash_erase,
+        };
+    }
+    else
+        ESP_LOGW(TAG, "No %s partition, offline buffer is RAM only", UPLINK_PARTITION_LABEL);
+
+    if (uplink_store_init(&s_store, part ? &s_flash : NULL) != 0)
+        ESP_LOGW(TAG, "Offline log unusable, buffer is RAM only");
+    else if (!uplink_store_empty(&s_store))
+        ESP_LOGI(TAG, "Recovered offline samples from flash");
+}
+
+static esp_err_t http_post(const uplink_buf_t *buf)
+{
+    esp_err_t err = esp_http_client_open(s_client, buf->len);
+    if (err == ESP_OK && esp_http_client_write(s_client, buf->data, buf->len) != buf->len)
+        err = ESP_FAIL;
+    if (err == ESP_OK && esp_http_client_fetch_headers(s_client) < 0)
+        err = ESP_FAIL;
+    if (err == ESP_OK)
+        err = esp_http_client_flush_response(s_client, NULL);
+
+    // Keep the connection for the next sample unless it broke
+    if (err != ESP_OK)
+        esp_http_client_close(s_client);
+
+    return err;
+}
+
+static esp_err_t udp_send(uplink_buf_t *buf)
+{
+    uplink_dgram_finish(buf->data, s_dgram_seq++, esp_timer_get_time() / 1000);
+    return send(s_sock, buf->data, buf->len, 0) == buf->len ? ESP_OK : ESP_FAIL;
+}
+
+// Returns the samples of an unsent buffer to the backlog
+static void store_buf(const uplink_buf_t *buf)
+{
+    uplink_sample_t sample;
+
+    if (s_transport != UPLINK_TRANSPORT_UDP)
+    {
+        store_push(&buf->sample);
+        return;
+    }
+    for (unsigned i = 0; i < buf->count; i++)
+    {
+        if (uplink_dgram_sample(buf->data, buf->len, i, &sample) == 0)
+            store_push(&sample);
+    }
+}
+
+static void send_buf(uint8_t idx)
+{
+    uplink_buf_t *buf = &s_pool[idx];
+    esp_err_t err;
+
+    // Buffers flushed or queued after the link went down are kept, not sent
+    if (!s_connected || (s_transport == UPLINK_TRANSPORT_UDP && s_sock < 0))
+    {
+        store_buf(buf);
+        xQueueSend(s_free_q, &idx, 0);
+        return;
+    }
+
+    if (s_transport == UPLINK_TRANSPORT_UDP)
+    {
+        // No retry, the backlog resends at its own rate
+        err = udp_send(buf);
+    }
+    else
+    {
+        // The server may have dropped an idle keep-alive connection, retry once
+        err = http_post(buf);
+        if (err != ESP_OK && s_connected)
+            err = http_post(buf);
+    }
+
+    if (err != ESP_OK)
+    {
+        stats_add(&s_stats.failed, 1);
+        store_buf(buf);
+        ESP_LOGD(TAG, "Send failed: %s", esp_err_to_name(err));
+        xQueueSend(s_free_q, &idx, 0);
+        return;
+    }
+
+    stats_add(&s_stats.sent, s_transport == UPLINK_TRANSPORT_UDP ? buf->count : 1);
+    if (!s_first_sent_ms)
+    {
+        // Only uplink_task sends, the shadow copy avoids locking on every send
+        s_first_sent_ms = esp_timer_get_time() / 1000;
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.first_sent_ms = s_first_sent_ms;
+        portEXIT_CRITICAL(&s_stats_lock);
+        ESP_LOGI(TAG, "First sample delivered %" PRIu32 " ms after boot", s_first_sent_ms);
+    }
+
+    xQueueSend(s_free_q, &idx, 0);
+}
+
+// Returns the number of samples sent from the backlog
+static uint32_t drain_one(void)
+{
+    uint8_t idx;
+    uint32_t count = 0;
+
+    if (xQueueReceive(s_free_q, &idx, 0) != pdTRUE)
+        return 0;
+
+    uplink_buf_t *buf = &s_pool[idx];
+    if (s_transport == UPLINK_TRANSPORT_UDP)
+    {
+        buf->len = uplink_dgram_begin(buf->data, s_device_id, s_boot);
+        while (buf->len + UPLINK_DGRAM_SAMPLE_SIZE <= sizeof(buf->data) && store_pop(&buf->sample))
+        {
+            buf->len = uplink_dgram_append(buf->data, buf->len, sizeof(buf->data), &buf->sample);
+            count++;
+        }
+        buf->count = count;
+    }
+    else if (store_pop(&buf->sample))
+    {
+        buf->len = uplink_encode_json(buf->data, sizeof(buf->data), &buf->sample, s_device_id);
+        count = 1;
+    }
+
+    if (!count)
+    {
+        xQueueSend(s_free_q, &idx, 0);
+        return 0;
+    }
+    stats_add(&s_stats.drained, count);
+    send_buf(idx);
+
+    return count;
+}
+
+// The socket needs the TCP/IP stack, which comes up with the WiFi link
+static void open_udp(void)
+{
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s_sock < 0)
+    {
+        ESP_LOGW(TAG, "UDP socket failed: %d", errno);
+        return;
+    }
+
+    // Fixes the destination so send_buf() can use send()
+    if (connect(s_sock, (struct sockaddr *)&s_udp_addr, sizeof(s_udp_addr)) != 0)
+    {
+        ESP_LOGW(TAG, "UDP connect failed: %d", errno);
+        close(s_sock);
+        s_sock = -1;
+    }
+}
+
+// A socket bound to the old link may not come back, open a new one next time
+static void close_udp(void)
+{
+    close(s_sock);
+    s_sock = -1;
+}
+
+// Sends the open datagram once it is due, or stores it once the link went down
+static void flush_open(bool force)
+{
+    int idx = -1;
+
+    xSemaphoreTake(s_open_lock, portMAX_DELAY);
+    if (s_open_idx >= 0 && (force || xTaskGetTickCount() - s_open_since >= pdMS_TO_TICKS(UPLINK_UDP_FLUSH_MS)))
+    {
+        idx = s_open_idx;
+        s_open_idx = -1;
+    }
+    xSemaphoreGive(s_open_lock);
+
+    if (idx >= 0)
+        send_buf(idx);
+}
+
+static void uplink_task(void *pvParameters)
+{
+    const TickType_t drain_period = pdMS_TO_TICKS(1000 / s_drain_per_sec);
+    TickType_t next_drain = xTaskGetTickCount();
+    uint8_t idx;
+
+    while (true)
+    {
+        // Emptiness is only a hint here, the RAM ring is shared with the producer
+        bool backlog = s_connected && !uplink_store_empty(&s_store);
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = pdMS_TO_TICKS(100);
+
+        if (s_transport == UPLINK_TRANSPORT_UDP && s_connected && s_sock < 0)
+            open_udp();
+        else if (s_transport == UPLINK_TRANSPORT_UDP && !s_connected && s_sock >= 0)
+            close_udp();
+
+        if (backlog)
+            wait = (int32_t)(next_drain - now) > 0 ? next_drain - now : 0;
+
+        // Read without the lock, flush_open() checks again
+        if (s_open_idx >= 0)
+        {
+            TickType_t due = s_open_since + pdMS_TO_TICKS(UPLINK_UDP_FLUSH_MS) - now;
+            if ((int32_t)due < 0)
+                due = 0;
+            if (due < wait)
+                wait = due;
+        }
+
+        // Live samples go out as they come, backlog at a fixed rate alongside
+        if (xQueueReceive(s_tx_q, &idx, wait) == pdTRUE)
+            send_buf(idx);
+
+        if (s_transport == UPLINK_TRANSPORT_UDP)
+            flush_open(!s_connected);
+        store_spill();
+
+        now = xTaskGetTickCount();
+        if (backlog && (int32_t)(now - next_drain) >= 0)
+        {
+            uint32_t count = drain_one();
+            next_drain = now + drain_period * (count ? count : 1);
+        }
+    }
+}
+
+static esp_err_t init_http(const uplink_config_t *cfg)
+{
+    if (!cfg->url)
+        return ESP_ERR_INVALID_ARG;
+
+    esp_http_client_config_t config = {
+        .url = cfg->url,
+        .method = HTTP_METHOD_POST,
+        .keep_alive_enable = true,
+    };
+    s_client = esp_http_client_init(&config);
+    if (!s_client)
+        return ESP_ERR_NO_MEM;
+
+    // Headers persist across requests on the same client
+    esp_http_client_set_header(s_client, "Content-Type", "application/json");
+
+    return ESP_OK;
+}
+
+static esp_err_t init_udp(const uplink_config_t *cfg)
+{
+    s_udp_addr.sin_family = AF_INET;
+    s_udp_addr.sin_port = htons(cfg->port);
+
+    if (!cfg->host || !cfg->port || inet_pton(AF_INET, cfg->host, &s_udp_addr.sin_addr) != 1)
+        return ESP_ERR_INVALID_ARG;
+
+    // The socket is opened by uplink_task once the network is up
+    s_open_lock = xSemaphoreCreateMutexStatic(&s_open_lock_buf);
+
+    return ESP_OK;
+}
+
+esp_err_t uplink_init(const uplink_config_t *cfg)
+{
+    if (!cfg)
+        return ESP_ERR_INVALID_ARG;
+
+    s_transport = cfg->transport;
+    s_device_id = cfg->device_id;
+    if (!s_device_id)
+    {
+        uint8_t mac[6];
+        esp_read_mac(mac, ESP_MAC_WIFI_STA);
+        s_device_id = (uint32_t)mac[2] << 24 | mac[3] << 16 | mac[4] << 8 | mac[5];
+    }
+
+    s_drain_per_sec = cfg->drain_per_sec ? cfg->drain_per_sec : UPLINK_DRAIN_PER_SEC;
+    if (s_drain_per_sec > 1000)
+        s_drain_per_sec = 1000;
+
+    esp_err_t err = s_transport == UPLINK_TRANSPORT_UDP ? init_udp(cfg) : init_http(cfg);
+    if (err != ESP_OK)
+        return err;
+
+    load_boot_counter();
+    s_store_lock = xSemaphoreCreateMutexStatic(&s_store_lock_buf);
+    init_store();
+
+    s_free_q = xQueueCreateStatic(UPLINK_POOL_SIZE, sizeof(uint8_t), s_free_q_storage, &s_free_q_buf);
+    s_tx_q = xQueueCreateStatic(UPLINK_POOL_SIZE, sizeof(uint8_t), s_tx_q_storage, &s_tx_q_buf);
+    for (uint8_t i = 0; i < UPLINK_POOL_SIZE; i++)
+        xQueueSend(s_free_q, &i, 0);
+
+    if (xTaskCreate(uplink_task, "uplink_task", UPLINK_TASK_STACK, NULL, UPLINK_TASK_PRIO, NULL) != pdPASS)
+        return ESP_ERR_NO_MEM;
+
+    ESP_LOGI(TAG, "Device %08" PRIx32 ", boot %u, %s transport", s_device_id, s_boot,
+             s_transport == UPLINK_TRANSPORT_UDP ? "UDP" : "HTTP");
+
+    return ESP_OK;
+}
+
+static esp_err_t submit_udp(const uplink_sample_t *sample)
+{
+    uplink_buf_t *buf;
+    uint8_t idx;
+
+    // uplink_task flushes the open datagram when it is due
+    xSemaphoreTake(s_open_lock, portMAX_DELAY);
+    if (s_open_idx < 0)
+    {
+        if (xQueueReceive(s_free_q, &idx, 0) != pdTRUE)
+        {
+            xSemaphoreGive(s_open_lock);
+            return ESP_ERR_NO_MEM;
+        }
+        s_open_idx = idx;
+        s_open_since = xTaskGetTickCount();
+        s_pool[idx].len = uplink_dgram_begin(s_pool[idx].data, s_device_id, s_boot);
+        s_pool[idx].count = 0;
+    }
+
+    buf = &s_pool[s_open_idx];
+    buf->len = uplink_dgram_append(buf->data, buf->len, sizeof(buf->data), sample);
+    buf->count++;
+
+    if (buf->len + UPLINK_DGRAM_SAMPLE_SIZE > sizeof(buf->data))
+    {
+        idx = s_open_idx;
+        s_open_idx = -1;
+        xQueueSend(s_tx_q, &idx, 0);
+    }
+    xSemaphoreGive(s_open_lock);
+
+    return ESP_OK;
+}
+
+static esp_err_t submit_http(const uplink_sample_t *sample)
+{
+    uint8_t idx;
+
+    if (xQueueReceive(s_free_q, &idx, 0) != pdTRUE)
+        return ESP_ERR_NO_MEM;
+
+    uplink_buf_t *buf = &s_pool[idx];
+    buf->sample = *sample;
+    buf->len = uplink_encode_json(buf->data, sizeof(buf->data), sample, s_device_id);
+    xQueueSend(s_tx_q, &idx, 0);
+
+    return ESP_OK;
+}
+
+esp_err_t uplink_submit(const uplink_sample_t *sample)
+{
+    uplink_sample_t s = *sample;
+
+    s.boot = s_boot;
+    s.seq = s_seq++;
+    s.timestamp_ms = esp_timer_get_time() / 1000;
+
+    if (!s_connected)
+    {
+        store_push(&s);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = s_transport == UPLINK_TRANSPORT_UDP ? submit_udp(&s) : submit_http(&s);
+    if (err == ESP_ERR_NO_MEM)
+    {
+        stats_add(&s_stats.dropped, 1);
+        store_push(&s);
+    }
+
+    return err;
+}
+
+void uplink_set_connected(bool connected)
+{
+    s_connected = connected;
+}
+
+void uplink_get_stats(uplink_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
@@ -0,0 +1,319 @@
+/**
+ * @file uplink_encode.c
+ *
+ * Sample serialization for the uplink transmit buffers.
+ *
+ * Has no ESP-IDF dependencies so it can be built and checked on the host:
+ *
+ *     gcc -O2 -Wall -Wextra -DUPLINK_ENCODE_HOST_CHECK -Icomponents/uplink/include \
+ *         components/uplink/uplink_encode.c -o uplink_encode_check
+ */
+#include "uplink_encode.h"
+#include <string.h>
+
+typedef struct
+{
+    char *p;
+    char *end;
+} writer_t;
+
+static void put_str(writer_t *w, const char *s, size_t len)
+{
+    if (w->p && (size_t)(w->end - w->p) >= len)
+    {
+        memcpy(w->p, s, len);
+        w->p += len;
+    }
+    else
+        w->p = NULL;
+}
+
+#define PUT_LIT(w, lit) put_str(w, lit, sizeof(lit) - 1)
+
+static void put_uint(writer_t *w, uint32_t v)
+{
+    char tmp[10];
+    size_t n = 0;
+
+    do
+    {
+        tmp[sizeof(tmp) - 1 - n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    put_str(w, tmp + sizeof(tmp) - n, n);
+}
+
+static void put_int(writer_t *w, int32_t v)
+{
+    if (v < 0)
+    {
+        PUT_LIT(w, "-");
+        put_uint(w, -(uint32_t)v);
+    }
+    else
+        put_uint(w, v);
+}
+
+// Fixed-point value with one decimal, e.g. 453 -> "45.3"
+static void put_deci(writer_t *w, int32_t v)
+{
+    uint32_t u = v < 0 ? -(uint32_t)v : (uint32_t)v;
+    char frac[2] = { '.', '0' + u % 10 };
+
+    if (v < 0)
+        PUT_LIT(w, "-");
+    put_uint(w, u / 10);
+    put_str(w, frac, sizeof(frac));
+}
+
+size_t uplink_encode_json(char *buf, size_t size, const uplink_sample_t *sample, uint32_t device_id)
+{
+    writer_t w = { buf, buf + size };
+
+    PUT_LIT(&w, "{\"angle\":");
+    put_int(&w, sample->angle);
+    PUT_LIT(&w, ",\"distance\":");
+    // No echo is reported as -1.0 cm
+    put_deci(&w, sample->distance_mm < 0 ? -10 : sample->distance_mm);
+    PUT_LIT(&w, ",\"dev\":");
+    put_uint(&w, device_id);
+    PUT_LIT(&w, ",\"boot\":");
+    put_uint(&w, sample->boot);
+    PUT_LIT(&w, ",\"seq\":");
+    put_uint(&w, sample->seq);
+    PUT_LIT(&w, ",\"ts\":");
+    put_uint(&w, sample->timestamp_ms);
+    PUT_LIT(&w, "}");
+
+    return w.p ? (size_t)(w.p - buf) : 0;
+}
+
+static char *put_le16(char *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static char *put_le32(char *p, uint32_t v)
+{
+    p = put_le16(p, v);
+    return put_le16(p, v >> 16);
+}
+
+size_t uplink_dgram_begin(char *buf, uint32_t device_id, uint16_t boot)
+{
+    char *p = put_le16(buf, UPLINK_DGRAM_MAGIC);
+    *p++ = UPLINK_DGRAM_VERSION;
+    *p++ = 0; // Sample count
+    p = put_le32(p, device_id);
+    p = put_le16(p, boot);
+    p = put_le16(p, 0);
+    p = put_le32(p, 0); // Sequence number and send time, see uplink_dgram_finish()
+    p = put_le32(p, 0);
+
+    return p - buf;
+}
+
+size_t uplink_dgram_append(char *buf, size_t len, size_t size, const uplink_sample_t *sample)
+{
+    if (len + UPLINK_DGRAM_SAMPLE_SIZE > size || (uint8_t)buf[3] == UINT8_MAX)
+        return 0;
+
+    char *p = put_le32(buf + len, sample->seq);
+    p = put_le32(p, sample->timestamp_ms);
+    p = put_le16(p, sample->boot);
+    p = put_le16(p, (uint16_t)sample->angle);
+    put_le32(p, (uint32_t)sample->distance_mm);
+    buf[3]++;
+
+    return len + UPLINK_DGRAM_SAMPLE_SIZE;
+}
+
+void uplink_dgram_finish(char *buf, uint32_t seq, uint32_t timestamp_ms)
+{
+    char *p = put_le32(buf + UPLINK_DGRAM_HEADER_SIZE - 8, seq);
+    put_le32(p, timestamp_ms);
+}
+
+static const char *get_le16(const char *p, uint16_t *v)
+{
+    *v = (uint8_t)p[0] | (uint8_t)p[1] << 8;
+    return p + 2;
+}
+
+static const char *get_le32(const char *p, uint32_t *v)
+{
+    uint16_t lo, hi;
+
+    p = get_le16(p, &lo);
+    p = get_le16(p, &hi);
+    *v = lo | (uint32_t)hi << 16;
+    return p;
+}
+
+int uplink_dgram_sample(const char *buf, size_t len, unsigned index, uplink_sample_t *sample)
+{
+    size_t offset = UPLINK_DGRAM_HEADER_SIZE + (size_t)index * UPLINK_DGRAM_SAMPLE_SIZE;
+    uint16_t angle;
+    uint32_t distance;
+
+    if (len < UPLINK_DGRAM_HEADER_SIZE || index >= (uint8_t)buf[3] || offset + UPLINK_DGRAM_SAMPLE_SIZE > len)
+        return -1;
+
+    const char *p = get_le32(buf + offset, &sample->seq);
+    p = get_le32(p, &sample->timestamp_ms);
+    p = get_le16(p, &sample->boot);
+    p = get_le16(p, &angle);
+    get_le32(p, &distance);
+    sample->angle = (int16_t)angle;
+    sample->distance_mm = (int32_t)distance;
+
+    return 0;
+}
+
+#ifdef UPLINK_ENCODE_HOST_CHECK
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#define CHECK_GUARD 0xA5
+
+// Datagram from rpi_server/udp_stream.py encode_datagram(0x01020304, 7,
+// 0xA0B0C0D0, 123456, [(42, 98120, 7, 270, 453), (0xFFFFFFFF, 1, 7, -32768, -1)])
+static const uint8_t s_golden[] = {
+    0x44, 0x52, 0x01, 0x02, 0x04, 0x03, 0x02, 0x01, 0x07, 0x00, 0x00, 0x00, 0xd0, 0xc0, 0xb0, 0xa0,
+    0x40, 0xe2, 0x01, 0x00, 0x2a, 0x00, 0x00, 0x00, 0x48, 0x7f, 0x01, 0x00, 0x07, 0x00, 0x0e, 0x01,
+    0xc5, 0x01, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x01, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x80,
+    0xff, 0xff, 0xff, 0xff,
+};
+
+static const uplink_sample_t s_samples[] = {
+    { .seq = 42, .timestamp_ms = 98120, .boot = 7, .angle = 270, .distance_mm = 453 },
+    { .seq = UINT32_MAX, .timestamp_ms = 1, .boot = 7, .angle = INT16_MIN, .distance_mm = -1 },
+};
+
+static int same_sample(const uplink_sample_t *a, const uplink_sample_t *b)
+{
+    return a->seq == b->seq && a->timestamp_ms == b->timestamp_ms && a->boot == b->boot && a->angle == b->angle
+        && a->distance_mm == b->distance_mm;
+}
+
+// Every shorter buffer is refused without writing past its end, the exact
+// size fits
+static int check_json_bounds(const uplink_sample_t *sample, uint32_t device_id, size_t len)
+{
+    char buf[128];
+
+    for (size_t size = 0; size <= len; size++)
+    {
+        memset(buf, CHECK_GUARD, sizeof(buf));
+        size_t res = uplink_encode_json(buf, size, sample, device_id);
+        if (res != (size == len ? len : 0) || (uint8_t)buf[size] != CHECK_GUARD)
+            return 1;
+    }
+    return 0;
+}
+
+static int check_json(void)
+{
+    static const struct
+    {
+        uplink_sample_t sample;
+        uint32_t device_id;
+        const char *expect;
+    } cases[] = {
+        { { 42, 98120, 7, 270, 453 }, 7, "{\"angle\":270,\"distance\":45.3,\"dev\":7,\"boot\":7,\"seq\":42,\"ts\":98120}" },
+        { { 0, 0, 0, 0, 0 }, 0, "{\"angle\":0,\"distance\":0.0,\"dev\":0,\"boot\":0,\"seq\":0,\"ts\":0}" },
+        { { UINT32_MAX, UINT32_MAX, UINT16_MAX, INT16_MIN, -1 }, UINT32_MAX,
+          "{\"angle\":-32768,\"distance\":-1.0,\"dev\":4294967295,\"boot\":65535,\"seq\":4294967295,"
+          "\"ts\":4294967295}" },
+        { { 1, 2, 3, INT16_MAX, INT32_MAX }, 1,
+          "{\"angle\":32767,\"distance\":214748364.7,\"dev\":1,\"boot\":3,\"seq\":1,\"ts\":2}" },
+    };
+    int fail = 0;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        const uplink_sample_t *in = &cases[i].sample;
+        char buf[128];
+        size_t len = uplink_encode_json(buf, sizeof(buf), in, cases[i].device_id);
+        int bad = len != strlen(cases[i].expect) || memcmp(buf, cases[i].expect, len) != 0;
+
+        // Read back the way the server does, distance in cm
+        long angle = 0;
+        double distance = 0;
+        unsigned long dev = 0, boot = 0, seq = 0, ts = 0;
+        buf[len] = '\0';
+        if (sscanf(buf, "{\"angle\":%ld,\"distance\":%lf,\"dev\":%lu,\"boot\":%lu,\"seq\":%lu,\"ts\":%lu}",
+                   &angle, &distance, &dev, &boot, &seq, &ts) != 6)
+            bad = 1;
+        long deci = (long)(distance * 10 + (distance < 0 ? -0.5 : 0.5));
+        if (angle != in->angle || deci != (in->distance_mm < 0 ? -10 : in->distance_mm) || dev != cases[i].device_id
+            || boot != in->boot || seq != in->seq || ts != in->timestamp_ms)
+            bad = 1;
+
+        bad |= check_json_bounds(in, cases[i].device_id, len);
+        printf("json %zu: %3zu bytes %s\n", i, len, bad ? "FAIL" : "ok");
+        fail |= bad;
+    }
+    return fail;
+}
+
+static int check_dgram(void)
+{
+    static char buf[UPLINK_DGRAM_HEADER_SIZE + 300 * UPLINK_DGRAM_SAMPLE_SIZE];
+    uplink_sample_t out;
+    int fail = 0;
+
+    // Same bytes as the server's encoder, and back
+    size_t len = uplink_dgram_begin(buf, 0x01020304, 7);
+    for (size_t i = 0; i < sizeof(s_samples) / sizeof(s_samples[0]); i++)
+        len = uplink_dgram_append(buf, len, sizeof(buf), &s_samples[i]);
+    uplink_dgram_finish(buf, 0xA0B0C0D0, 123456);
+    int bad = len != sizeof(s_golden) || memcmp(buf, s_golden, len) != 0;
+    for (unsigned i = 0; i < sizeof(s_samples) / sizeof(s_samples[0]); i++)
+        bad |= uplink_dgram_sample(buf, len, i, &out) != 0 || !same_sample(&out, &s_samples[i]);
+    bad |= uplink_dgram_sample(buf, len, 2, &out) == 0 || uplink_dgram_sample(buf, len - 1, 1, &out) == 0
+        || uplink_dgram_sample(buf, UPLINK_DGRAM_HEADER_SIZE - 1, 0, &out) == 0;
+    printf("dgram layout: %zu bytes %s\n", len, bad ? "FAIL" : "ok");
+    fail |= bad;
+
+    // Fills a transmit buffer up to the last whole sample
+    const size_t mtu = 1400;
+    size_t expect = (mtu - UPLINK_DGRAM_HEADER_SIZE) / UPLINK_DGRAM_SAMPLE_SIZE;
+    unsigned count = 0;
+    memset(buf, CHECK_GUARD, sizeof(buf));
+    len = uplink_dgram_begin(buf, 1, 1);
+    for (size_t next; (next = uplink_dgram_append(buf, len, mtu, &s_samples[count % 2])); len = next)
+        count++;
+    bad = count != expect || (uint8_t)buf[3] != expect || len != UPLINK_DGRAM_HEADER_SIZE + expect * UPLINK_DGRAM_SAMPLE_SIZE
+        || (uint8_t)buf[len] != CHECK_GUARD;
+    for (unsigned i = 0; i < count; i++)
+        bad |= uplink_dgram_sample(buf, len, i, &out) != 0 || !same_sample(&out, &s_samples[i % 2]);
+    printf("dgram full:   %u samples in %zu bytes %s\n", count, len, bad ? "FAIL" : "ok");
+    fail |= bad;
+
+    // The count byte caps a datagram at 255 samples whatever the buffer size
+    count = 0;
+    len = uplink_dgram_begin(buf, 1, 1);
+    for (size_t next; (next = uplink_dgram_append(buf, len, sizeof(buf), &s_samples[0])); len = next)
+        count++;
+    bad = count != UINT8_MAX || (uint8_t)buf[3] != UINT8_MAX || uplink_dgram_sample(buf, len, UINT8_MAX, &out) == 0;
+    printf("dgram cap:    %u samples %s\n", count, bad ? "FAIL" : "ok");
+    fail |= bad;
+
+    return fail;
+}
+
+int main(void)
+{
+    int fail = check_json();
+
+    fail |= check_dgram();
+
+    printf(fail ? "FAIL\n" : "OK\n");
+    return fail;
+}
+
+#endif /* UPLINK_ENCODE_HOST_CHECK */
@@ -0,0 +1,507 @@
+/**
+ * @file uplink_store.c
+ *
+ * Store-and-forward queue: RAM ring spilling into a circular flash log.
+ *
+ * Has no ESP-IDF dependencies so it can be built and checked on the host
+ * against a RAM-backed flash:
+ *
+ *     gcc -O2 -DUPLINK_STORE_HOST_CHECK -Icomponents/uplink/include \
+ *         components/uplink/uplink_store.c -o store_check
+ */
+#include "uplink_store.h"
+#include <stddef.h>
+#include <string.h>
+
+#define LOG_MAGIC 0x32474c52 // "RLG2", records carry a drained flag
+
+#define REC_PENDING 0xFF
+#define REC_DRAINED 0x00 // Programmed over REC_PENDING without an erase
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t gen; //!< Increments for every sector started, orders the log
+    uint32_t reserved[2];
+} log_header_t;
+
+typedef struct
+{
+    uint32_t seq;
+    uint32_t timestamp_ms;
+    uint16_t boot;
+    int16_t angle;
+    int16_t distance_mm; //!< Range, mm, -1 when nothing was detected
+    uint8_t flags;       //!< `REC_PENDING` until drained, outside the CRC
+    uint8_t crc;
+} log_record_t;
+
+#define REC_CRC_LEN offsetof(log_record_t, flags)
+
+_Static_assert(sizeof(log_header_t) == 16, "log header size");
+_Static_assert(sizeof(log_record_t) == 16, "log record size");
+
+static uint8_t crc8(const uint8_t *data, uint32_t len)
+{
+    uint8_t crc = 0;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static bool is_erased(const void *data, uint32_t len)
+{
+    const uint8_t *p = data;
+
+    while (len--)
+        if (*p++ != 0xFF)
+            return false;
+    return true;
+}
+
+static uint32_t records_per_sector(const uplink_store_t *store)
+{
+    return (store->flash->sector_size - sizeof(log_header_t)) / sizeof(log_record_t);
+}
+
+static uint32_t record_offset(const uplink_store_t *store, uint32_t sector, uint32_t rec)
+{
+    return sector * store->flash->sector_size + sizeof(log_header_t) + rec * sizeof(log_record_t);
+}
+
+static uint32_t next_sector(const uplink_store_t *store, uint32_t sector)
+{
+    return sector + 1 == store->sectors ? 0 : sector + 1;
+}
+
+static bool log_empty(const uplink_store_t *store)
+{
+    return !store->flash || (store->tail_sector == store->head_sector && store->tail_rec == store->head_rec);
+}
+
+static int read_header(const uplink_store_t *store, uint32_t sector, log_header_t *hdr)
+{
+    const uplink_flash_t *f = store->flash;
+
+    if (f->read(f->ctx, sector * f->sector_size, hdr, sizeof(*hdr)))
+        return -1;
+    return hdr->magic == LOG_MAGIC ? 0 : 1;
+}
+
+static int start_sector(uplink_store_t *store, uint32_t sector, uint32_t gen)
+{
+    const uplink_flash_t *f = store->flash;
+    log_header_t hdr = { .magic = LOG_MAGIC, .gen = gen, .reserved = { 0xFFFFFFFF, 0xFFFFFFFF } };
+
+    if (f->erase(f->ctx, sector * f->sector_size, f->sector_size))
+        return -1;
+    return f->write(f->ctx, sector * f->sector_size, &hdr, sizeof(hdr));
+}
+
+// 1 = valid record, 0 = erased slot (end of data), -1 = error or torn write
+static int read_record(const uplink_store_t *store, uint32_t sector, uint32_t rec, log_record_t *r)
+{
+    const uplink_flash_t *f = store->flash;
+
+    if (f->read(f->ctx, record_offset(store, sector, rec), r, sizeof(*r)))
+        return -1;
+    if (is_erased(r, sizeof(*r)))
+        return 0;
+    return crc8((const uint8_t *)r, REC_CRC_LEN) == r->crc ? 1 : -1;
+}
+
+// Moves the tail to the next record still to be drained, true if there is one
+static bool log_next(uplink_store_t *store, log_record_t *r)
+{
+    const uplink_flash_t *f = store->flash;
+    uint32_t rps = records_per_sector(store);
+
+    while (!log_empty(store))
+    {
+        if (store->tail_rec == rps)
+        {
+            // Sector fully drained, release it
+            f->erase(f->ctx, store->tail_sector * f->sector_size, f->sector_size);
+            store->tail_sector = next_sector(store, store->tail_sector);
+            store->tail_rec = 0;
+            continue;
+        }
+
+        int res = read_record(store, store->tail_sector, store->tail_rec, r);
+        if (res == 0)
+        {
+            // Sector was closed early after a torn write
+            store->tail_rec = store->tail_sector == store->head_sector ? store->head_rec : rps;
+            continue;
+        }
+        if (res < 0)
+        {
+            store->dropped++;
+            store->tail_rec++;
+            continue;
+        }
+        if (r->flags != REC_PENDING)
+        {
+            // Drained before a reset
+            store->tail_rec++;
+            continue;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+static int log_format(uplink_store_t *store)
+{
+    store->gen = 1;
+    store->head_sector = store->tail_sector = 0;
+    store->head_rec = store->tail_rec = 0;
+    return start_sector(store, 0, store->gen);
+}
+
+static int log_mount(uplink_store_t *store)
+{
+    log_header_t hdr;
+    bool found = false;
+
+    // Head is the sector with the newest generation
+    for (uint32_t s = 0; s < store->sectors; s++)
+    {
+        int res = read_header(store, s, &hdr);
+        if (res < 0)
+            return -1;
+        if (res == 0 && (!found || (int32_t)(hdr.gen - store->gen) > 0))
+        {
+            found = true;
+            store->gen = hdr.gen;
+            store->head_sector = s;
+        }
+    }
+    if (!found)
+        return log_format(store);
+
+    // Tail is the oldest sector of the contiguous run ending at the head
+    store->tail_sector = store->head_sector;
+    for (uint32_t n = 1; n < store->sectors; n++)
+    {
+        uint32_t prev = store->tail_sector ? store->tail_sector - 1 : store->sectors - 1;
+        if (read_header(store, prev, &hdr) != 0 || hdr.gen != store->gen - n)
+            break;
+        store->tail_sector = prev;
+    }
+    store->tail_rec = 0;
+
+    // Append after the last record written before reset
+    log_record_t r;
+    uint32_t rps = records_per_sector(store);
+    for (store->head_rec = 0; store->head_rec < rps; store->head_rec++)
+    {
+        int res = read_record(store, store->head_sector, store->head_rec, &r);
+        if (res == 0)
+            break;
+        if (res < 0)
+        {
+            // Torn write, continue in a fresh sector
+            store->head_rec = rps;
+            break;
+        }
+    }
+
+    // Resume after the last record drained before reset
+    log_next(store, &r);
+
+    return 0;
+}
+
+static int log_append(uplink_store_t *store, const uplink_sample_t *sample)
+{
+    const uplink_flash_t *f = store->flash;
+
+    if (store->head_rec == records_per_sector(store))
+    {
+        uint32_t next = next_sector(store, store->head_sector);
+        if (next == store->tail_sector)
+        {
+            // Log full, discard the oldest sector
+            store->dropped += records_per_sector(store) - store->tail_rec;
+            store->tail_sector = next_sector(store, store->tail_sector);
+            store->tail_rec = 0;
+        }
+        if (start_sector(store, next, store->gen + 1))
+            return -1;
+        store->gen++;
+        store->head_sector = next;
+        store->head_rec = 0;
+    }
+
+    log_record_t r = {
+        .seq = sample->seq,
+        .timestamp_ms = sample->timestamp_ms,
+        .boot = sample->boot,
+        .angle = sample->angle,
+        .distance_mm = sample->distance_mm < 0 ? -1
+                       : sample->distance_mm > INT16_MAX ? INT16_MAX : (int16_t)sample->distance_mm,
+        .flags = REC_PENDING,
+    };
+    r.crc = crc8((const uint8_t *)&r, REC_CRC_LEN);
+
+    if (f->write(f->ctx, record_offset(store, store->head_sector, store->head_rec), &r, sizeof(r)))
+        return -1;
+    store->head_rec++;
+
+    return 0;
+}
+
+static bool log_pop(uplink_store_t *store, uplink_sample_t *sample)
+{
+    const uplink_flash_t *f = store->flash;
+    const uint8_t drained = REC_DRAINED;
+    log_record_t r;
+
+    if (!log_next(store, &r))
+        return false;
+
+    f->write(f->ctx, record_offset(store, store->tail_sector, store->tail_rec) + offsetof(log_record_t, flags),
+             &drained, sizeof(drained));
+    store->tail_rec++;
+
+    sample->seq = r.seq;
+    sample->timestamp_ms = r.timestamp_ms;
+    sample->boot = r.boot;
+    sample->angle = r.angle;
+    sample->distance_mm = r.distance_mm;
+    return true;
+}
+
+int uplink_store_init(uplink_store_t *store, const uplink_flash_t *flash)
+{
+    memset(store, 0, sizeof(*store));
+
+    if (!flash || flash->sector_size <= sizeof(log_header_t) || flash->size < 2 * flash->sector_size)
+        return flash ? -1 : 0;
+
+    store->flash = flash;
+    store->sectors = flash->size / flash->sector_size;
+    if (log_mount(store))
+    {
+        store->flash = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void uplink_store_push(uplink_store_t *store, const uplink_sample_t *sample)
+{
+    if (store->ram_count == UPLINK_STORE_RAM_SIZE)
+    {
+        // Spill fell behind, lose the oldest
+        store->ram_head = (store->ram_head + 1) % UPLINK_STORE_RAM_SIZE;
+        store->ram_count--;
+        store->ram_dropped++;
+    }
+
+    store->ram[(store->ram_head + store->ram_count) % UPLINK_STORE_RAM_SIZE] = *sample;
+    store->ram_count++;
+}
+
+uint32_t uplink_store_take_spill(uplink_store_t *store, uplink_sample_t *batch)
+{
+    uint32_t count = 0;
+
+    if (store->ram_count < UPLINK_STORE_SPILL_AT)
+        return 0;
+
+    // Oldest samples, so they stay older than anything left in RAM
+    while (count < UPLINK_STORE_SPILL && uplink_store_pop_ram(store, &batch[count]))
+        count++;
+
+    return count;
+}
+
+void uplink_store_spill(uplink_store_t *store, const uplink_sample_t *batch, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+        if (!store->flash || log_append(store, &batch[i]))
+            store->dropped++;
+}
+
+bool uplink_store_pop_log(uplink_store_t *store, uplink_sample_t *sample)
+{
+    return store->flash && log_pop(store, sample);
+}
+
+bool uplink_store_pop_ram(uplink_store_t *store, uplink_sample_t *sample)
+{
+    if (!store->ram_count)
+        return false;
+
+    *sample = store->ram[store->ram_head];
+    store->ram_head = (store->ram_head + 1) % UPLINK_STORE_RAM_SIZE;
+    store->ram_count--;
+
+    return true;
+}
+
+bool uplink_store_pop(uplink_store_t *store, uplink_sample_t *sample)
+{
+    return uplink_store_pop_log(store, sample) || uplink_store_pop_ram(store, sample);
+}
+
+bool uplink_store_empty(const uplink_store_t *store)
+{
+    return !store->ram_count && log_empty(store);
+}
+
+#ifdef UPLINK_STORE_HOST_CHECK
+
+#include <stdio.h>
+
+#define SECTOR_SIZE 4096
+#define SECTORS     8
+
+// NOR flash in RAM: writes can only clear bits, erases set a sector to 0xFF
+static uint8_t s_flash[SECTORS * SECTOR_SIZE];
+static uint32_t s_erases[SECTORS];
+
+static int ram_read(void *ctx, uint32_t offset, void *dst, uint32_t len)
+{
+    (void)ctx;
+    memcpy(dst, &s_flash[offset], len);
+    return 0;
+}
+
+static int ram_write(void *ctx, uint32_t offset, const void *src, uint32_t len)
+{
+    (void)ctx;
+    const uint8_t *p = src;
+
+    for (uint32_t i = 0; i < len; i++)
+        s_flash[offset + i] &= p[i];
+    return 0;
+}
+
+static int ram_erase(void *ctx, uint32_t offset, uint32_t len)
+{
+    (void)ctx;
+    memset(&s_flash[offset], 0xFF, len);
+    s_erases[offset / SECTOR_SIZE]++;
+    return 0;
+}
+
+static const uplink_flash_t s_ram_flash = {
+    .size = sizeof(s_flash),
+    .sector_size = SECTOR_SIZE,
+    .read = ram_read,
+    .write = ram_write,
+    .erase = ram_erase,
+};
+
+static uplink_store_t s_store;
+static uint32_t s_next_seq;
+
+// Producer side of an outage, spilling the way uplink_task does
+static void produce(uint32_t count)
+{
+    uplink_sample_t batch[UPLINK_STORE_SPILL];
+
+    while (count--)
+    {
+        uplink_sample_t s = { .seq = s_next_seq, .timestamp_ms = s_next_seq * 10, .angle = s_next_seq % 360,
+                              .distance_mm = s_next_seq % 4000 };
+        s_next_seq++;
+        uplink_store_push(&s_store, &s);
+        uplink_store_spill(&s_store, batch, uplink_store_take_spill(&s_store, batch));
+    }
+}
+
+// Drains up to `count` samples, checking they come out oldest first
+static int drain(uint32_t count, uint32_t *expect)
+{
+    uplink_sample_t s;
+    int fail = 0;
+
+    while (count-- && uplink_store_pop(&s_store, &s))
+    {
+        if (s.seq < *expect || s.distance_mm != (int32_t)(s.seq % 4000))
+            fail = 1;
+        *expect = s.seq + 1;
+    }
+    return fail;
+}
+
+// RAM is lost, only the log survives
+static void reboot(void)
+{
+    uplink_store_init(&s_store, &s_ram_flash);
+}
+
+int main(void)
+{
+    uint32_t rps = (SECTOR_SIZE - sizeof(log_header_t)) / sizeof(log_record_t);
+    uint32_t expect = 0;
+    uplink_sample_t s;
+    int fail = 0;
+
+    memset(s_flash, 0xFF, sizeof(s_flash));
+    uplink_store_init(&s_store, &s_ram_flash);
+
+    // Outage shorter than the log: everything comes back in order
+    produce(1000);
+    fail |= drain(UINT32_MAX, &expect);
+    printf("outage:      %u sent, %u drained, %u dropped\n", s_next_seq, expect, s_store.dropped);
+    fail |= expect != s_next_seq || s_store.dropped;
+
+    // Reboot half way through draining: resume after the last sample taken
+    produce(1000);
+    uint32_t logged = 1000 - s_store.ram_count;
+    fail |= drain(logged / 2, &expect);
+    uint32_t resume = expect;
+    reboot();
+    fail |= !uplink_store_pop(&s_store, &s) || s.seq != resume;
+    expect = s.seq + 1;
+    fail |= drain(UINT32_MAX, &expect);
+    printf("remount:     resumed at %u (expected %u), drained to %u\n", s.seq, resume, expect);
+
+    // Reboot after a full drain: nothing is sent again
+    produce(300);
+    fail |= drain(UINT32_MAX, &expect);
+    reboot();
+    printf("full drain:  %s after remount\n", uplink_store_empty(&s_store) ? "empty" : "NOT EMPTY");
+    fail |= !uplink_store_empty(&s_store);
+
+    // Outage longer than the log: oldest sectors go, order is kept
+    uint32_t capacity = (SECTORS - 1) * rps;
+    produce(capacity * 3);
+    uint32_t before = expect;
+    fail |= drain(UINT32_MAX, &expect);
+    printf("wrap-around: log %u records, %u dropped, resumed at %u\n", capacity, s_store.dropped,
+           before);
+    fail |= expect != s_next_seq || !s_store.dropped;
+
+    // Many outages: erases spread over every sector
+    for (int i = 0; i < 200; i++)
+    {
+        produce(700);
+        fail |= drain(UINT32_MAX, &expect);
+    }
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (int i = 0; i < SECTORS; i++)
+    {
+        lo = s_erases[i] < lo ? s_erases[i] : lo;
+        hi = s_erases[i] > hi ? s_erases[i] : hi;
+    }
+    printf("erases:      %u..%u per sector\n", lo, hi);
+    fail |= hi > lo + 2;
+
+    printf(fail ? "FAIL\n" : "OK\n");
+    return fail;
+}
+
+#endif /* UPLINK_STORE_HOST_CHECK */
@@ -0,0 +1,161 @@
+#ifndef __WIFI_FSM_H__
+#define __WIFI_FSM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Association state kept across reboots
+ *
+ * IPv4 addresses are in network byte order, as lwIP keeps them.
+ */
+typedef struct
+{
+    uint8_t version;  //!< `WIFI_CACHE_VERSION`, other values are ignored
+    uint8_t ap_valid; //!< `bssid` and `channel` are known
+    uint8_t ip_valid; //!< `ip`, `gw`, `netmask` and `dns` are known
+    uint8_t channel;
+    uint8_t bssid[6];
+    uint32_t ip;
+    uint32_t gw;
+    uint32_t netmask;
+    uint32_t dns;
+} wifi_cache_t;
+
+#define WIFI_CACHE_VERSION 1
+
+/**
+ * Connection timing and policy
+ */
+typedef struct
+{
+    uint32_t fast_timeout_ms;    //!< Connect to the cached AP, give up after this
+    uint8_t fast_attempts;       //!< Cached AP attempts before falling back to a full scan
+    uint32_t connect_timeout_ms; //!< Full scan and association, give up after this
+    uint32_t dhcp_timeout_ms;    //!< Association to DHCP lease, give up after this
+    uint32_t verify_ms;          //!< A reused lease must be confirmed within this, 0 to trust it
+    uint32_t backoff_min_ms;     //!< First retry delay after a failed full scan
+    uint32_t backoff_max_ms;     //!< Retry delay cap
+    bool reuse_ip;               //!< Reuse the last lease instead of running DHCP
+    bool static_ip;              //!< Address in the cache is configured, never cleared or verified
+} wifi_fsm_config_t;
+
+typedef enum
+{
+    WIFI_FSM_IDLE = 0,
+    WIFI_FSM_FAST_CONNECT,  //!< Associating with the cached BSSID on the cached channel
+    WIFI_FSM_SCAN_CONNECT,  //!< Associating after a full scan
+    WIFI_FSM_BACKOFF,       //!< Waiting before the next attempt
+    WIFI_FSM_WAIT_IP,       //!< Associated, DHCP running
+    WIFI_FSM_UP_UNVERIFIED, //!< Up on a reused lease, waiting for the gateway to answer on it
+    WIFI_FSM_UP,
+} wifi_fsm_state_t;
+
+typedef enum
+{
+    WIFI_FSM_EV_START = 0,
+    WIFI_FSM_EV_ASSOCIATED,   //!< `bssid` and `channel` set
+    WIFI_FSM_EV_DISCONNECTED, //!< Association failed or was lost
+    WIFI_FSM_EV_GOT_IP,       //!< DHCP lease, `ip` ... `dns` set
+    WIFI_FSM_EV_VERIFIED,     //!< Gateway answered on the reused address
+    WIFI_FSM_EV_IP_REJECTED,  //!< `WIFI_FSM_ACT_USE_CACHED_IP` failed, the address is not in use
+    WIFI_FSM_EV_TICK,         //!< Time passed, sent at least by `deadline_ms`
+} wifi_fsm_event_type_t;
+
+typedef struct
+{
+    wifi_fsm_event_type_t type;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t gw;
+    uint32_t netmask;
+    uint32_t dns;
+} wifi_fsm_event_t;
+
+// Actions the caller carries out, in this order, after an event
+#define WIFI_FSM_ACT_DISCONNECT    (1u << 0) //!< Abort the current attempt
+#define WIFI_FSM_ACT_USE_CACHED_IP (1u << 1) //!< Stop DHCP, apply the cached address
+#define WIFI_FSM_ACT_START_DHCP    (1u << 2) //!< Drop the applied address, run DHCP
+#define WIFI_FSM_ACT_CONNECT_FAST  (1u << 3) //!< Connect to the cached BSSID and channel, no scan
+#define WIFI_FSM_ACT_CONNECT_SCAN  (1u << 4) //!< Connect after a full scan
+#define WIFI_FSM_ACT_SAVE_CACHE    (1u << 5) //!< Persist `cache`
+#define WIFI_FSM_ACT_LINK_UP       (1u << 6) //!< Network usable
+#define WIFI_FSM_ACT_LINK_DOWN     (1u << 7) //!< Network gone
+
+/**
+ * Connection counters
+ */
+typedef struct
+{
+    uint32_t fast_connects; //!< Associations without a scan
+    uint32_t scan_connects; //!< Associations after a full scan
+    uint32_t fast_failures; //!< Cached AP attempts that failed
+    uint32_t cached_ips;    //!< Links brought up on a reused lease
+    uint32_t dhcp_leases;
+    uint32_t ip_fallbacks;  //!< Reused leases the gateway did not answer on
+    uint32_t first_up_ms;   //!< START to the first link up, 0 until then
+} wifi_fsm_stats_t;
+
+/**
+ * Connection state machine
+ *
+ * Pure logic: fed with events and the current time, it returns the actions
+ * to carry out and the time it next needs a `WIFI_FSM_EV_TICK`.
+ */
+typedef struct
+{
+    wifi_fsm_config_t cfg;
+    wifi_cache_t cache;
+    wifi_fsm_state_t state;
+    bool next_fast;       //!< BACKOFF: next attempt uses the cached AP
+    bool ip_applied;      //!< Cached address applied, DHCP stopped
+    uint8_t attempts;     //!< Failed attempts in the current phase
+    uint32_t start_ms;
+    uint32_t deadline_ms; //!< Next TICK due, only meaningful if `timer`
+    bool timer;
+    wifi_fsm_stats_t stats;
+} wifi_fsm_t;
+
+/**
+ * @brief Init the state machine in `WIFI_FSM_IDLE`
+ *
+ * @param fsm State machine
+ * @param cfg Timing and policy
+ * @param cache Association state loaded from storage, NULL if none
+ */
+void wifi_fsm_init(wifi_fsm_t *fsm, const wifi_fsm_config_t *cfg, const wifi_cache_t *cache);
+
+/**
+ * @brief Handle an event
+ *
+ * @param fsm State machine
+ * @param ev Event
+ * @param now_ms Current time, ms
+ * @return `WIFI_FSM_ACT_*` bits
+ */
+uint32_t wifi_fsm_handle(wifi_fsm_t *fsm, const wifi_fsm_event_t *ev, uint32_t now_ms);
+
+/**
+ * @brief Time until the next TICK is due
+ *
+ * @param fsm State machine
+ * @param now_ms Current time, ms
+ * @return ms, UINT32_MAX if no TICK is needed
+ */
+uint32_t wifi_fsm_wait_ms(const wifi_fsm_t *fsm, uint32_t now_ms);
+
+/**
+ * @brief Name of a state, for logs
+ */
+const char *wifi_fsm_state_name(wifi_fsm_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_FSM_H__ */
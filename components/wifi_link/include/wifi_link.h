@@ -0,0 +1,67 @@
+#ifndef __WIFI_LINK_H__
+#define __WIFI_LINK_H__
+
+#include <stdbool.h>
+#include <esp_err.h>
+#include "wifi_fsm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Connection timing, see `wifi_fsm_config_t`
+ */
+#define WIFI_LINK_FAST_TIMEOUT_MS    1500
+#define WIFI_LINK_FAST_ATTEMPTS      2
+#define WIFI_LINK_CONNECT_TIMEOUT_MS 15000
+#define WIFI_LINK_DHCP_TIMEOUT_MS    10000
+#define WIFI_LINK_VERIFY_MS          5000
+#define WIFI_LINK_PING_INTERVAL_MS   250 // Gateway pings while a reused lease is unverified
+#define WIFI_LINK_BACKOFF_MIN_MS     250
+#define WIFI_LINK_BACKOFF_MAX_MS     10000
+
+/**
+ * Link configuration
+ */
+typedef struct
+{
+    const char *ssid;
+    const char *password;
+    const char *static_ip;       //!< Dotted IPv4 address, NULL to use DHCP
+    const char *gateway;         //!< With `static_ip`
+    const char *netmask;         //!< With `static_ip`
+    const char *dns;             //!< With `static_ip`, NULL for none
+    bool fast_connect;           //!< Connect to the cached AP without scanning
+    bool reuse_lease;            //!< Reuse the last DHCP lease, it is not renewed afterwards
+    bool verify_lease;           //!< Ping the gateway on a reused lease, run DHCP if it does not answer
+    void (*on_link)(bool up);    //!< Called from the link task when the network comes and goes
+} wifi_link_config_t;
+
+/**
+ * @brief Bring the WiFi station up in the background
+ *
+ * Returns without waiting for the connection. A task connects and keeps the
+ * link up: it tries the AP and the lease cached in NVS by the previous boot
+ * first and falls back to a full scan and DHCP when they fail. Requires NVS
+ * to be initialized.
+ *
+ * @param cfg Link configuration, strings must outlive the link
+ * @return `ESP_OK` on success
+ */
+esp_err_t wifi_link_start(const wifi_link_config_t *cfg);
+
+/**
+ * @brief Get connection counters
+ *
+ * Safe to call from any task.
+ *
+ * @param[out] stats Counters
+ */
+void wifi_link_get_stats(wifi_fsm_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __WIFI_LINK_H__ */
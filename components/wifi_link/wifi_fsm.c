@@ -0,0 +1,521 @@
+/**
+ * @file wifi_fsm.c
+ *
+ * WiFi fast-connect state machine. A reboot or a dropped link first tries
+ * the cached BSSID on the cached channel, which skips the all-channel scan,
+ * and brings the link up on the last DHCP lease, which skips DHCP. Either
+ * shortcut falls back to the slow path when it fails: a cached AP that
+ * does not answer is forgotten and scanned for, a reused lease the gateway
+ * does not answer on is dropped and DHCP is run.
+ *
+ * Has no ESP-IDF dependencies so it can be built and checked on the host:
+ *
+ *     gcc -O2 -DWIFI_FSM_HOST_CHECK -Icomponents/wifi_link/include \
+ *         components/wifi_link/wifi_fsm.c -o wifi_fsm_check
+ */
+#include "wifi_fsm.h"
+#include <string.h>
+
+static void arm(wifi_fsm_t *fsm, uint32_t now_ms, uint32_t ms)
+{
+    fsm->timer = true;
+    fsm->deadline_ms = now_ms + ms;
+}
+
+static bool use_cached_ip(const wifi_fsm_t *fsm)
+{
+    return fsm->cache.ip_valid && (fsm->cfg.reuse_ip || fsm->cfg.static_ip);
+}
+
+static uint32_t begin_attempt(wifi_fsm_t *fsm, bool fast, uint32_t now_ms)
+{
+    uint32_t act = 0;
+
+    // Addressing is set before connecting so DHCP does not start on association
+    if (use_cached_ip(fsm) && !fsm->ip_applied)
+    {
+        act |= WIFI_FSM_ACT_USE_CACHED_IP;
+        fsm->ip_applied = true;
+    }
+    else if (!use_cached_ip(fsm) && fsm->ip_applied)
+    {
+        act |= WIFI_FSM_ACT_START_DHCP;
+        fsm->ip_applied = false;
+    }
+
+    if (fast && fsm->cache.ap_valid)
+    {
+        fsm->state = WIFI_FSM_FAST_CONNECT;
+        arm(fsm, now_ms, fsm->cfg.fast_timeout_ms);
+        return act | WIFI_FSM_ACT_CONNECT_FAST;
+    }
+    fsm->state = WIFI_FSM_SCAN_CONNECT;
+    arm(fsm, now_ms, fsm->cfg.connect_timeout_ms);
+    return act | WIFI_FSM_ACT_CONNECT_SCAN;
+}
+
+static uint32_t backoff(wifi_fsm_t *fsm, uint32_t now_ms, bool next_fast, uint32_t delay_ms)
+{
+    fsm->state = WIFI_FSM_BACKOFF;
+    fsm->next_fast = next_fast;
+    arm(fsm, now_ms, delay_ms);
+    return 0;
+}
+
+static uint32_t scan_failed(wifi_fsm_t *fsm, uint32_t now_ms)
+{
+    uint32_t delay = fsm->cfg.backoff_min_ms;
+
+    fsm->attempts++;
+    for (uint8_t i = 1; i < fsm->attempts && delay < fsm->cfg.backoff_max_ms; i++)
+        delay *= 2;
+    if (delay > fsm->cfg.backoff_max_ms)
+        delay = fsm->cfg.backoff_max_ms;
+    return backoff(fsm, now_ms, false, delay);
+}
+
+static uint32_t fast_failed(wifi_fsm_t *fsm, uint32_t now_ms, bool timed_out)
+{
+    uint32_t act = timed_out ? WIFI_FSM_ACT_DISCONNECT : 0;
+    bool next_fast = true;
+
+    fsm->stats.fast_failures++;
+    if (++fsm->attempts >= fsm->cfg.fast_attempts)
+    {
+        // AP moved to another channel or is gone, find it again
+        fsm->cache.ap_valid = 0;
+        fsm->attempts = 0;
+        next_fast = false;
+        act |= WIFI_FSM_ACT_SAVE_CACHE;
+    }
+
+    // After an abort, let the disconnect it causes land in BACKOFF
+    if (timed_out)
+        return act | backoff(fsm, now_ms, next_fast, fsm->cfg.backoff_min_ms);
+    return act | begin_attempt(fsm, next_fast, now_ms);
+}
+
+static uint32_t link_up(wifi_fsm_t *fsm, uint32_t now_ms)
+{
+    if (fsm->ip_applied && !fsm->cfg.static_ip && fsm->cfg.verify_ms)
+    {
+        fsm->state = WIFI_FSM_UP_UNVERIFIED;
+        arm(fsm, now_ms, fsm->cfg.verify_ms);
+    }
+    else
+    {
+        fsm->state = WIFI_FSM_UP;
+        fsm->timer = false;
+    }
+    fsm->attempts = 0;
+    if (!fsm->stats.first_up_ms)
+        fsm->stats.first_up_ms = now_ms - fsm->start_ms ? now_ms - fsm->start_ms : 1;
+    return WIFI_FSM_ACT_LINK_UP;
+}
+
+static bool set_ip(wifi_fsm_t *fsm, const wifi_fsm_event_t *ev)
+{
+    wifi_cache_t *c = &fsm->cache;
+
+    if (c->ip_valid && c->ip == ev->ip && c->gw == ev->gw && c->netmask == ev->netmask && c->dns == ev->dns)
+        return false;
+    c->ip = ev->ip;
+    c->gw = ev->gw;
+    c->netmask = ev->netmask;
+    c->dns = ev->dns;
+    c->ip_valid = 1;
+    return true;
+}
+
+void wifi_fsm_init(wifi_fsm_t *fsm, const wifi_fsm_config_t *cfg, const wifi_cache_t *cache)
+{
+    memset(fsm, 0, sizeof(*fsm));
+    fsm->cfg = *cfg;
+    if (!fsm->cfg.fast_attempts)
+        fsm->cfg.fast_attempts = 1;
+    if (cache && cache->version == WIFI_CACHE_VERSION)
+        fsm->cache = *cache;
+    fsm->cache.version = WIFI_CACHE_VERSION;
+    fsm->state = WIFI_FSM_IDLE;
+}
+
+uint32_t wifi_fsm_handle(wifi_fsm_t *fsm, const wifi_fsm_event_t *ev, uint32_t now_ms)
+{
+    uint32_t act = 0;
+
+    switch (ev->type)
+    {
+    case WIFI_FSM_EV_START:
+        if (fsm->state != WIFI_FSM_IDLE)
+            return 0;
+        fsm->start_ms = now_ms;
+        fsm->attempts = 0;
+        return begin_attempt(fsm, true, now_ms);
+
+    case WIFI_FSM_EV_ASSOCIATED:
+        if (fsm->state != WIFI_FSM_FAST_CONNECT && fsm->state != WIFI_FSM_SCAN_CONNECT)
+            return 0;
+        if (fsm->state == WIFI_FSM_FAST_CONNECT)
+            fsm->stats.fast_connects++;
+        else
+            fsm->stats.scan_connects++;
+
+        if (!fsm->cache.ap_valid || fsm->cache.channel != ev->channel ||
+            memcmp(fsm->cache.bssid, ev->bssid, sizeof(ev->bssid)))
+        {
+            memcpy(fsm->cache.bssid, ev->bssid, sizeof(ev->bssid));
+            fsm->cache.channel = ev->channel;
+            fsm->cache.ap_valid = 1;
+            act |= WIFI_FSM_ACT_SAVE_CACHE;
+        }
+        fsm->attempts = 0;
+
+        if (fsm->ip_applied)
+        {
+            fsm->stats.cached_ips++;
+            return act | link_up(fsm, now_ms);
+        }
+        fsm->state = WIFI_FSM_WAIT_IP;
+        arm(fsm, now_ms, fsm->cfg.dhcp_timeout_ms);
+        return act;
+
+    case WIFI_FSM_EV_DISCONNECTED:
+        switch (fsm->state)
+        {
+        case WIFI_FSM_FAST_CONNECT:
+            return fast_failed(fsm, now_ms, false);
+        case WIFI_FSM_SCAN_CONNECT:
+            return scan_failed(fsm, now_ms);
+        case WIFI_FSM_UP:
+        case WIFI_FSM_UP_UNVERIFIED:
+            act = WIFI_FSM_ACT_LINK_DOWN;
+            // fall through
+        case WIFI_FSM_WAIT_IP:
+            // Same AP is most likely still there, no scan
+            fsm->attempts = 0;
+            return act | begin_attempt(fsm, true, now_ms);
+        default:
+            return 0;
+        }
+
+    case WIFI_FSM_EV_GOT_IP:
+        if (fsm->state == WIFI_FSM_WAIT_IP)
+        {
+            fsm->stats.dhcp_leases++;
+            set_ip(fsm, ev);
+            return WIFI_FSM_ACT_SAVE_CACHE | link_up(fsm, now_ms);
+        }
+        // Renewed lease with a new address
+        if (fsm->state == WIFI_FSM_UP && !fsm->ip_applied && set_ip(fsm, ev))
+            return WIFI_FSM_ACT_SAVE_CACHE;
+        return 0;
+
+    case WIFI_FSM_EV_VERIFIED:
+        if (fsm->state == WIFI_FSM_UP_UNVERIFIED)
+        {
+            fsm->state = WIFI_FSM_UP;
+            fsm->timer = false;
+        }
+        return 0;
+
+    case WIFI_FSM_EV_IP_REJECTED:
+        // Sent right after the attempt that applied the address, which
+        // then associates on DHCP instead
+        if (!fsm->ip_applied || (fsm->state != WIFI_FSM_FAST_CONNECT && fsm->state != WIFI_FSM_SCAN_CONNECT))
+            return 0;
+        fsm->stats.ip_fallbacks++;
+        fsm->cache.ip_valid = 0;
+        fsm->ip_applied = false;
+        return WIFI_FSM_ACT_START_DHCP | WIFI_FSM_ACT_SAVE_CACHE;
+
+    case WIFI_FSM_EV_TICK:
+        if (!fsm->timer || (int32_t)(now_ms - fsm->deadline_ms) < 0)
+            return 0;
+        fsm->timer = false;
+        switch (fsm->state)
+        {
+        case WIFI_FSM_FAST_CONNECT:
+            return fast_failed(fsm, now_ms, true);
+        case WIFI_FSM_SCAN_CONNECT:
+            return WIFI_FSM_ACT_DISCONNECT | scan_failed(fsm, now_ms);
+        case WIFI_FSM_BACKOFF:
+            return begin_attempt(fsm, fsm->next_fast, now_ms);
+        case WIFI_FSM_WAIT_IP:
+            // No lease, associate again
+            return WIFI_FSM_ACT_DISCONNECT | backoff(fsm, now_ms, true, fsm->cfg.backoff_min_ms);
+        case WIFI_FSM_UP_UNVERIFIED:
+            // Lease was handed to someone else or the network changed
+            fsm->stats.ip_fallbacks++;
+            fsm->cache.ip_valid = 0;
+            fsm->ip_applied = false;
+            fsm->state = WIFI_FSM_WAIT_IP;
+            arm(fsm, now_ms, fsm->cfg.dhcp_timeout_ms);
+            return WIFI_FSM_ACT_LINK_DOWN | WIFI_FSM_ACT_START_DHCP | WIFI_FSM_ACT_SAVE_CACHE;
+        default:
+            return 0;
+        }
+    }
+    return 0;
+}
+
+uint32_t wifi_fsm_wait_ms(const wifi_fsm_t *fsm, uint32_t now_ms)
+{
+    if (!fsm->timer)
+        return UINT32_MAX;
+    int32_t left = (int32_t)(fsm->deadline_ms - now_ms);
+    return left > 0 ? (uint32_t)left : 0;
+}
+
+const char *wifi_fsm_state_name(wifi_fsm_state_t state)
+{
+    static const char *const names[] = {
+        [WIFI_FSM_IDLE] = "idle",
+        [WIFI_FSM_FAST_CONNECT] = "fast-connect",
+        [WIFI_FSM_SCAN_CONNECT] = "scan-connect",
+        [WIFI_FSM_BACKOFF] = "backoff",
+        [WIFI_FSM_WAIT_IP] = "wait-ip",
+        [WIFI_FSM_UP_UNVERIFIED] = "up-unverified",
+        [WIFI_FSM_UP] = "up",
+    };
+    return state <= WIFI_FSM_UP ? names[state] : "?";
+}
+
+#ifdef WIFI_FSM_HOST_CHECK
+
+#include <stdio.h>
+
+// Rough ESP32 timings, ms
+#define SIM_FAST_ASSOC_MS 150  // Probe on one channel, auth, assoc, 4-way handshake
+#define SIM_FAST_MISS_MS  300  // Probe on the cached channel gets no answer
+#define SIM_SCAN_MS       2300 // Active and passive scan of 13 channels
+#define SIM_DHCP_MS       1500 // DISCOVER to ACK
+#define SIM_PING_MS       10   // Gateway answers the first ping
+#define SIM_VERIFY_MS     3000 // Reused lease confirmation window
+
+typedef struct
+{
+    const char *name;
+    bool cached;      //!< Cache from an earlier boot
+    bool ap_moved;    //!< Cached BSSID and channel are stale
+    bool lease_taken; //!< Cached address is stale
+    bool ip_refused;  //!< Network interface does not take the cached address
+    bool drop;        //!< Link drops once up, time the reconnect
+    uint32_t link_ms; //!< Latest expected link up
+    uint32_t up_ms;   //!< Latest expected verified link
+    wifi_fsm_stats_t expect; //!< Expected path and addressing counts
+} sim_scenario_t;
+
+typedef struct
+{
+    uint32_t at;
+    wifi_fsm_event_t ev;
+} sim_event_t;
+
+#define SIM_QUEUE 8
+
+typedef struct
+{
+    sim_event_t q[SIM_QUEUE];
+    int n;
+    bool ap_moved;
+    bool ip_refused;
+    bool ip_good; //!< Gateway answers on the address in use
+} sim_t;
+
+static void sim_post(sim_t *sim, uint32_t at, wifi_fsm_event_type_t type)
+{
+    if (sim->n == SIM_QUEUE)
+        return;
+    sim_event_t *e = &sim->q[sim->n++];
+    memset(e, 0, sizeof(*e));
+    e->at = at;
+    e->ev.type = type;
+    static const uint8_t bssid[6] = { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01 };
+    memcpy(e->ev.bssid, bssid, sizeof(bssid));
+    e->ev.channel = 6;
+    e->ev.ip = 0x2a01a8c0;
+    e->ev.gw = 0x0101a8c0;
+    e->ev.netmask = 0x00ffffff;
+    e->ev.dns = 0x0101a8c0;
+}
+
+static void sim_cancel(sim_t *sim, wifi_fsm_event_type_t type)
+{
+    for (int i = 0; i < sim->n; i++)
+        if (sim->q[i].ev.type == type)
+            sim->q[i--] = sim->q[--sim->n];
+}
+
+static void sim_apply(sim_t *sim, wifi_fsm_t *fsm, uint32_t act, uint32_t now)
+{
+    // Same as wifi_link.c: a refused address is reported before going on
+    if (act & WIFI_FSM_ACT_USE_CACHED_IP && sim->ip_refused)
+        act |= wifi_fsm_handle(fsm, &(wifi_fsm_event_t){ .type = WIFI_FSM_EV_IP_REJECTED }, now);
+    if (act & WIFI_FSM_ACT_DISCONNECT)
+    {
+        sim_cancel(sim, WIFI_FSM_EV_ASSOCIATED);
+        sim_cancel(sim, WIFI_FSM_EV_DISCONNECTED);
+        sim_post(sim, now + 5, WIFI_FSM_EV_DISCONNECTED);
+    }
+    if (act & WIFI_FSM_ACT_START_DHCP)
+    {
+        sim->ip_good = true;
+        if (fsm->state == WIFI_FSM_WAIT_IP)
+            sim_post(sim, now + SIM_DHCP_MS, WIFI_FSM_EV_GOT_IP);
+    }
+    if (act & WIFI_FSM_ACT_CONNECT_FAST)
+        sim_post(sim, now + (sim->ap_moved ? SIM_FAST_MISS_MS : SIM_FAST_ASSOC_MS),
+                 sim->ap_moved ? WIFI_FSM_EV_DISCONNECTED : WIFI_FSM_EV_ASSOCIATED);
+    if (act & WIFI_FSM_ACT_CONNECT_SCAN)
+    {
+        sim->ap_moved = false;
+        sim_post(sim, now + SIM_SCAN_MS + SIM_FAST_ASSOC_MS, WIFI_FSM_EV_ASSOCIATED);
+    }
+    if (act & WIFI_FSM_ACT_LINK_UP && sim->ip_good)
+        sim_post(sim, now + SIM_PING_MS, WIFI_FSM_EV_VERIFIED);
+}
+
+// Returns the time the link was first up and verified, 0 on timeout
+static uint32_t sim_until_up(sim_t *sim, wifi_fsm_t *fsm, uint32_t now, uint32_t *link_ms)
+{
+    *link_ms = 0;
+    while (now < 120000)
+    {
+        // Next environment event or FSM deadline
+        int next = -1;
+        for (int i = 0; i < sim->n; i++)
+            if (next < 0 || sim->q[i].at < sim->q[next].at)
+                next = i;
+        uint32_t wait = wifi_fsm_wait_ms(fsm, now);
+        wifi_fsm_event_t ev = { .type = WIFI_FSM_EV_TICK };
+        if (next >= 0 && (wait == UINT32_MAX || sim->q[next].at <= now + wait))
+        {
+            now = sim->q[next].at;
+            ev = sim->q[next].ev;
+            sim->q[next] = sim->q[--sim->n];
+        }
+        else if (wait != UINT32_MAX)
+            now += wait;
+        else
+            return 0;
+
+        uint32_t act = wifi_fsm_handle(fsm, &ev, now);
+        // Associating on DHCP starts the client
+        if (ev.type == WIFI_FSM_EV_ASSOCIATED && fsm->state == WIFI_FSM_WAIT_IP)
+            sim_post(sim, now + SIM_DHCP_MS, WIFI_FSM_EV_GOT_IP);
+        if (act & WIFI_FSM_ACT_LINK_UP && !*link_ms)
+            *link_ms = now;
+        sim_apply(sim, fsm, act, now);
+        if (fsm->state == WIFI_FSM_UP)
+            return now;
+    }
+    return 0;
+}
+
+// Full scans that never find the AP: retry delays double from the minimum
+// and stay at the cap
+static int check_backoff(const wifi_fsm_config_t *cfg)
+{
+    wifi_fsm_t fsm;
+    uint32_t now = 0, expect = cfg->backoff_min_ms;
+    int fail = 0;
+
+    wifi_fsm_init(&fsm, cfg, NULL);
+    uint32_t act = wifi_fsm_handle(&fsm, &(wifi_fsm_event_t){ .type = WIFI_FSM_EV_START }, now);
+    fail |= !(act & WIFI_FSM_ACT_CONNECT_SCAN);
+
+    printf("back-off:");
+    for (int i = 0; i < 8; i++)
+    {
+        now += SIM_SCAN_MS;
+        wifi_fsm_handle(&fsm, &(wifi_fsm_event_t){ .type = WIFI_FSM_EV_DISCONNECTED }, now);
+        uint32_t delay = wifi_fsm_wait_ms(&fsm, now);
+        printf(" %u", delay);
+        fail |= fsm.state != WIFI_FSM_BACKOFF || delay != expect;
+        expect = expect * 2 < cfg->backoff_max_ms ? expect * 2 : cfg->backoff_max_ms;
+
+        now += delay;
+        act = wifi_fsm_handle(&fsm, &(wifi_fsm_event_t){ .type = WIFI_FSM_EV_TICK }, now);
+        fail |= !(act & WIFI_FSM_ACT_CONNECT_SCAN) || (act & WIFI_FSM_ACT_CONNECT_FAST);
+    }
+    printf(" ms %s\n", fail ? "FAIL" : "ok");
+    return fail;
+}
+
+int main(void)
+{
+    // Cached paths only pay for the steps they cannot skip
+    static const sim_scenario_t scenarios[] = {
+        { "cold boot, empty cache", false, false, false, false, false, SIM_SCAN_MS + SIM_FAST_ASSOC_MS + SIM_DHCP_MS,
+          SIM_SCAN_MS + SIM_FAST_ASSOC_MS + SIM_DHCP_MS, { .scan_connects = 1, .dhcp_leases = 1 } },
+        { "warm boot, cache valid", true, false, false, false, false, SIM_FAST_ASSOC_MS,
+          SIM_FAST_ASSOC_MS + SIM_PING_MS, { .fast_connects = 1, .cached_ips = 1 } },
+        { "warm boot, AP moved", true, true, false, false, false, SIM_FAST_MISS_MS + SIM_SCAN_MS + SIM_FAST_ASSOC_MS,
+          SIM_FAST_MISS_MS + SIM_SCAN_MS + SIM_FAST_ASSOC_MS + SIM_PING_MS, { .scan_connects = 1, .cached_ips = 1 } },
+        { "warm boot, lease taken", true, false, true, false, false, SIM_FAST_ASSOC_MS,
+          SIM_FAST_ASSOC_MS + SIM_VERIFY_MS + SIM_DHCP_MS,
+          { .fast_connects = 1, .cached_ips = 1, .dhcp_leases = 1, .ip_fallbacks = 1 } },
+        { "warm boot, IP refused", true, false, false, true, false, SIM_FAST_ASSOC_MS + SIM_DHCP_MS,
+          SIM_FAST_ASSOC_MS + SIM_DHCP_MS, { .fast_connects = 1, .dhcp_leases = 1, .ip_fallbacks = 1 } },
+        { "link drop, reconnect", true, false, false, false, true, SIM_FAST_ASSOC_MS, SIM_FAST_ASSOC_MS + SIM_PING_MS,
+          { .fast_connects = 2, .cached_ips = 2 } },
+    };
+    const wifi_fsm_config_t cfg = {
+        .fast_timeout_ms = 1500,
+        .fast_attempts = 1,
+        .connect_timeout_ms = 10000,
+        .dhcp_timeout_ms = 10000,
+        .verify_ms = SIM_VERIFY_MS,
+        .backoff_min_ms = 250,
+        .backoff_max_ms = 8000,
+        .reuse_ip = true,
+    };
+    int fail = 0;
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+    {
+        const sim_scenario_t *s = &scenarios[i];
+        wifi_cache_t cache = { .version = WIFI_CACHE_VERSION };
+        if (s->cached)
+        {
+            cache.ap_valid = cache.ip_valid = 1;
+            cache.channel = 6;
+            memcpy(cache.bssid, (uint8_t[]){ 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01 }, 6);
+            cache.ip = 0x2a01a8c0;
+        }
+
+        wifi_fsm_t fsm;
+        sim_t sim = { .ap_moved = s->ap_moved, .ip_refused = s->ip_refused, .ip_good = !s->lease_taken };
+        wifi_fsm_init(&fsm, &cfg, &cache);
+        sim_apply(&sim, &fsm, wifi_fsm_handle(&fsm, &(wifi_fsm_event_t){ .type = WIFI_FSM_EV_START }, 0), 0);
+
+        uint32_t link_ms, up_ms = sim_until_up(&sim, &fsm, 0, &link_ms);
+        bool first_ok = fsm.stats.first_up_ms == link_ms;
+        if (s->drop && up_ms)
+        {
+            uint32_t t0 = up_ms + 10000;
+            sim.n = 0;
+            sim_apply(&sim, &fsm, wifi_fsm_handle(&fsm, &(wifi_fsm_event_t){ .type = WIFI_FSM_EV_DISCONNECTED }, t0), t0);
+            up_ms = sim_until_up(&sim, &fsm, t0, &link_ms);
+            link_ms -= t0;
+            up_ms -= t0;
+        }
+
+        const wifi_fsm_stats_t *st = &fsm.stats, *e = &s->expect;
+        bool ok = first_ok && up_ms && link_ms <= s->link_ms && up_ms <= s->up_ms &&
+                  st->fast_connects == e->fast_connects && st->scan_connects == e->scan_connects &&
+                  st->cached_ips == e->cached_ips && st->dhcp_leases == e->dhcp_leases &&
+                  st->ip_fallbacks == e->ip_fallbacks;
+        fail |= !ok;
+
+        printf("%-24s link up %5u ms, verified %5u ms, %u fast / %u scan, %u cached IP / %u DHCP, %u fallback %s\n",
+               s->name, link_ms, up_ms, st->fast_connects, st->scan_connects, st->cached_ips, st->dhcp_leases,
+               st->ip_fallbacks, ok ? "ok" : "FAIL");
+    }
+    fail |= check_backoff(&cfg);
+
+    printf(fail ? "FAIL\n" : "OK\n");
+    return fail;
+}
+
+#endif /* WIFI_FSM_HOST_CHECK */
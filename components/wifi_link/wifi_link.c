@@ -0,0 +1,336 @@
+/**
+ * @file wifi_link.c
+ *
+ * WiFi station bring-up driven by the `wifi_fsm` state machine. WiFi and IP
+ * events are queued to a task which feeds them to the state machine and
+ * carries out the actions it returns. Association state (BSSID, channel,
+ * last lease) is kept in NVS so the next boot connects without a scan and
+ * without DHCP. A reused lease is confirmed by pinging the gateway from it.
+ */
+#include "wifi_link.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_wifi.h>
+#include <esp_netif.h>
+#include <esp_event.h>
+#include <esp_timer.h>
+#include <esp_log.h>
+#include <ping/ping_sock.h>
+#include <inttypes.h>
+#include <string.h>
+#include <nvs.h>
+
+#define WIFI_LINK_TASK_STACK 4096
+#define WIFI_LINK_TASK_PRIO  4
+#define WIFI_LINK_QUEUE_LEN  8
+
+#define WIFI_LINK_NVS_NAMESPACE "wifi_link"
+#define WIFI_LINK_NVS_KEY       "cache"
+
+static const char *TAG = "wifi_link";
+
+static wifi_link_config_t s_cfg;
+static wifi_fsm_t s_fsm;
+static QueueHandle_t s_event_q;
+static esp_netif_t *s_netif;
+static esp_ping_handle_t s_ping; //!< Gateway ping while a reused lease is unverified
+
+// Copy of `s_fsm.stats` for other tasks, the state machine is link_task only
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static wifi_fsm_stats_t s_stats;
+
+static uint32_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static void load_cache(wifi_cache_t *cache)
+{
+    nvs_handle_t nvs;
+    size_t len = sizeof(*cache);
+
+    memset(cache, 0, sizeof(*cache));
+    if (nvs_open(WIFI_LINK_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+        return;
+    if (nvs_get_blob(nvs, WIFI_LINK_NVS_KEY, cache, &len) != ESP_OK || len != sizeof(*cache))
+        memset(cache, 0, sizeof(*cache));
+    nvs_close(nvs);
+}
+
+static void save_cache(const wifi_cache_t *cache)
+{
+    nvs_handle_t nvs;
+
+    if (nvs_open(WIFI_LINK_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "NVS unavailable, association state not saved");
+        return;
+    }
+    nvs_set_blob(nvs, WIFI_LINK_NVS_KEY, cache, sizeof(*cache));
+    nvs_commit(nvs);
+    nvs_close(nvs);
+}
+
+static void event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    wifi_fsm_event_t ev = { 0 };
+
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_CONNECTED)
+    {
+        wifi_event_sta_connected_t *e = data;
+        ev.type = WIFI_FSM_EV_ASSOCIATED;
+        memcpy(ev.bssid, e->bssid, sizeof(ev.bssid));
+        ev.channel = e->channel;
+    }
+    else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED)
+        ev.type = WIFI_FSM_EV_DISCONNECTED;
+    else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP)
+    {
+        ip_event_got_ip_t *e = data;
+        esp_netif_dns_info_t dns = { 0 };
+        esp_netif_get_dns_info(e->esp_netif, ESP_NETIF_DNS_MAIN, &dns);
+        ev.type = WIFI_FSM_EV_GOT_IP;
+        ev.ip = e->ip_info.ip.addr;
+        ev.gw = e->ip_info.gw.addr;
+        ev.netmask = e->ip_info.netmask.addr;
+        ev.dns = dns.ip.u_addr.ip4.addr;
+    }
+    else
+        return;
+
+    xQueueSend(s_event_q, &ev, 0);
+}
+
+static void connect(bool fast)
+{
+    wifi_config_t wifi_config = {
+        .sta = {
+            .scan_method = fast ? WIFI_FAST_SCAN : WIFI_ALL_CHANNEL_SCAN,
+            .sort_method = WIFI_CONNECT_AP_BY_SIGNAL,
+        },
+    };
+
+    strlcpy((char *)wifi_config.sta.ssid, s_cfg.ssid, sizeof(wifi_config.sta.ssid));
+    strlcpy((char *)wifi_config.sta.password, s_cfg.password, sizeof(wifi_config.sta.password));
+    if (fast)
+    {
+        // Probe a single channel for a single AP
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, s_fsm.cache.bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.channel = s_fsm.cache.channel;
+    }
+
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    esp_err_t err = esp_wifi_connect();
+    if (err != ESP_OK)
+        ESP_LOGW(TAG, "Connect failed: %s", esp_err_to_name(err));
+}
+
+static esp_err_t use_cached_ip(void)
+{
+    const wifi_cache_t *c = &s_fsm.cache;
+    esp_netif_ip_info_t info = {
+        .ip.addr = c->ip,
+        .gw.addr = c->gw,
+        .netmask.addr = c->netmask,
+    };
+
+    esp_err_t err = esp_netif_dhcpc_stop(s_netif);
+    if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED)
+        return err;
+    err = esp_netif_set_ip_info(s_netif, &info);
+    if (err != ESP_OK)
+        return err;
+    if (c->dns)
+    {
+        esp_netif_dns_info_t dns = {
+            .ip.type = ESP_IPADDR_TYPE_V4,
+            .ip.u_addr.ip4.addr = c->dns,
+        };
+        esp_netif_set_dns_info(s_netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    return ESP_OK;
+}
+
+static void on_ping_reply(esp_ping_handle_t hdl, void *args)
+{
+    const wifi_fsm_event_t ev = { .type = WIFI_FSM_EV_VERIFIED };
+
+    xQueueSend(s_event_q, &ev, 0);
+}
+
+// Any reply proves the address is usable on this network; the pings run
+// until the state machine stops waiting for one
+static void start_verify(void)
+{
+    esp_ping_config_t config = ESP_PING_DEFAULT_CONFIG();
+    esp_ping_callbacks_t cbs = { .on_ping_success = on_ping_reply };
+
+    config.target_addr.type = IPADDR_TYPE_V4;
+    config.target_addr.u_addr.ip4.addr = s_fsm.cache.gw;
+    config.count = ESP_PING_COUNT_INFINITE;
+    config.interval_ms = WIFI_LINK_PING_INTERVAL_MS;
+    config.timeout_ms = WIFI_LINK_PING_INTERVAL_MS;
+
+    if (esp_ping_new_session(&config, &cbs, &s_ping) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Gateway ping unavailable, lease falls back to DHCP");
+        s_ping = NULL;
+        return;
+    }
+    esp_ping_start(s_ping);
+}
+
+static void stop_verify(void)
+{
+    if (!s_ping)
+        return;
+    esp_ping_stop(s_ping);
+    esp_ping_delete_session(s_ping);
+    s_ping = NULL;
+}
+
+static void carry_out(uint32_t act)
+{
+    if (act & WIFI_FSM_ACT_DISCONNECT)
+        esp_wifi_disconnect();
+    if (act & WIFI_FSM_ACT_USE_CACHED_IP)
+    {
+        esp_err_t err = use_cached_ip();
+        if (err != ESP_OK)
+        {
+            // Adds running DHCP to the actions below, before connecting
+            const wifi_fsm_event_t rejected = { .type = WIFI_FSM_EV_IP_REJECTED };
+            ESP_LOGW(TAG, "Cached address not applied (%s), using DHCP", esp_err_to_name(err));
+            act |= wifi_fsm_handle(&s_fsm, &rejected, now_ms());
+        }
+    }
+    if (act & WIFI_FSM_ACT_START_DHCP)
+        esp_netif_dhcpc_start(s_netif);
+    if (act & WIFI_FSM_ACT_CONNECT_FAST)
+        connect(true);
+    if (act & WIFI_FSM_ACT_CONNECT_SCAN)
+        connect(false);
+    if (act & WIFI_FSM_ACT_SAVE_CACHE)
+        save_cache(&s_fsm.cache);
+
+    if (act & WIFI_FSM_ACT_LINK_UP)
+    {
+        const wifi_fsm_stats_t *st = &s_fsm.stats;
+        ESP_LOGI(TAG, "Link up %" PRIu32 " ms after boot on " IPSTR " (%s), %" PRIu32 " fast / %" PRIu32 " scan connects",
+                 now_ms(), IP2STR((esp_ip4_addr_t *)&s_fsm.cache.ip), s_fsm.ip_applied ? "cached" : "DHCP",
+                 st->fast_connects, st->scan_connects);
+        if (s_cfg.on_link)
+            s_cfg.on_link(true);
+    }
+    if (act & WIFI_FSM_ACT_LINK_DOWN)
+    {
+        ESP_LOGI(TAG, "Link down (%s)", wifi_fsm_state_name(s_fsm.state));
+        if (s_cfg.on_link)
+            s_cfg.on_link(false);
+    }
+}
+
+static void handle(const wifi_fsm_event_t *ev)
+{
+    bool unverified = s_fsm.state == WIFI_FSM_UP_UNVERIFIED;
+
+    carry_out(wifi_fsm_handle(&s_fsm, ev, now_ms()));
+
+    if (!unverified && s_fsm.state == WIFI_FSM_UP_UNVERIFIED)
+        start_verify();
+    else if (unverified && s_fsm.state != WIFI_FSM_UP_UNVERIFIED)
+        stop_verify();
+
+    portENTER_CRITICAL(&s_stats_lock);
+    s_stats = s_fsm.stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static void link_task(void *pvParameters)
+{
+    const wifi_fsm_event_t tick = { .type = WIFI_FSM_EV_TICK };
+    wifi_fsm_event_t ev = { .type = WIFI_FSM_EV_START };
+
+    handle(&ev);
+
+    while (true)
+    {
+        uint32_t wait = wifi_fsm_wait_ms(&s_fsm, now_ms());
+        TickType_t ticks = wait == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait) + 1;
+        if (xQueueReceive(s_event_q, &ev, ticks) == pdTRUE)
+            handle(&ev);
+
+        // A steady stream of events must not hold off timeouts
+        handle(&tick);
+    }
+}
+
+esp_err_t wifi_link_start(const wifi_link_config_t *cfg)
+{
+    if (!cfg || !cfg->ssid || !cfg->password)
+        return ESP_ERR_INVALID_ARG;
+    s_cfg = *cfg;
+
+    wifi_fsm_config_t fsm_cfg = {
+        .fast_timeout_ms = WIFI_LINK_FAST_TIMEOUT_MS,
+        .fast_attempts = WIFI_LINK_FAST_ATTEMPTS,
+        .connect_timeout_ms = WIFI_LINK_CONNECT_TIMEOUT_MS,
+        .dhcp_timeout_ms = WIFI_LINK_DHCP_TIMEOUT_MS,
+        .verify_ms = cfg->verify_lease ? WIFI_LINK_VERIFY_MS : 0,
+        .backoff_min_ms = WIFI_LINK_BACKOFF_MIN_MS,
+        .backoff_max_ms = WIFI_LINK_BACKOFF_MAX_MS,
+        .reuse_ip = cfg->reuse_lease,
+        .static_ip = cfg->static_ip != NULL,
+    };
+    wifi_cache_t cache;
+    load_cache(&cache);
+    if (!cfg->fast_connect)
+        cache.ap_valid = 0;
+
+    if (cfg->static_ip)
+    {
+        cache.version = WIFI_CACHE_VERSION;
+        cache.ip = esp_ip4addr_aton(cfg->static_ip);
+        cache.gw = cfg->gateway ? esp_ip4addr_aton(cfg->gateway) : 0;
+        cache.netmask = cfg->netmask ? esp_ip4addr_aton(cfg->netmask) : 0;
+        cache.dns = cfg->dns ? esp_ip4addr_aton(cfg->dns) : 0;
+        cache.ip_valid = 1;
+    }
+    wifi_fsm_init(&s_fsm, &fsm_cfg, &cache);
+
+    s_event_q = xQueueCreate(WIFI_LINK_QUEUE_LEN, sizeof(wifi_fsm_event_t));
+    if (!s_event_q)
+        return ESP_ERR_NO_MEM;
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    s_netif = esp_netif_create_default_wifi_sta();
+
+    wifi_init_config_t init_cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&init_cfg));
+
+    // Config changes on every connect, keep it out of flash
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL));
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    if (xTaskCreate(link_task, "wifi_link_task", WIFI_LINK_TASK_STACK, NULL, WIFI_LINK_TASK_PRIO, NULL) != pdPASS)
+        return ESP_ERR_NO_MEM;
+
+    ESP_LOGI(TAG, "Connecting to %s, %s", cfg->ssid,
+             s_fsm.cache.ap_valid ? "cached AP" : "full scan");
+
+    return ESP_OK;
+}
+
+void wifi_link_get_stats(wifi_fsm_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
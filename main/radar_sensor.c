@@ -1,28 +1,85 @@
 #include <stdio.h>
 #include <stdbool.h>
+#include <inttypes.h>
 #include <math.h>
 #include <string.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/event_groups.h>
+#include <esp_timer.h>
+#include <esp_rom_sys.h>
 #include <ultrasonic.h>
-#include <ssd1351.h>
+#include <ultrasonic_sched.h>
+#include <scan_plan.h>
+#include <scan_servo.h>
+#include <scan_delta.h>
+#include <display_panels.h>
+#include <radar_view.h>
 #include <esp_err.h>
+#include <esp_system.h>
 #include "esp_log.h"
 #include "nvs_flash.h"
-#include "esp_wifi.h"
-#include "esp_event.h"
-#include "esp_http_client.h"
+#include <wifi_link.h>
+#include <uplink.h>
 
 // WiFi Configuration - CHANGE THESE!
 #define WIFI_SSID      "BadeshaHome"
 #define WIFI_PASS      "Canucks@2011"
 #define RPI_SERVER_URL "http://192.168.1.90:5000/api/radar"
+#define RPI_SERVER_IP  "192.168.1.90"
+#define RPI_UDP_PORT   5001
 
-#define MAX_DISTANCE_CM 200 // 2m max for display scaling
+// Reboots and drops reconnect to the cached AP without scanning and reuse
+// the last lease without DHCP. The reused lease is not renewed, give the
+// sensor a DHCP reservation or a static address
+#define WIFI_FAST_CONNECT 1
+#define WIFI_REUSE_LEASE  1
+#define WIFI_STATIC_IP    NULL // e.g. "192.168.1.60", NULL for DHCP
+#define WIFI_GATEWAY      "192.168.1.1"
+#define WIFI_NETMASK      "255.255.255.0"
+#define WIFI_DNS          "192.168.1.1"
+
+// UPLINK_TRANSPORT_UDP streams datagrams, no retransmits on a lossy link
+#define UPLINK_TRANSPORT UPLINK_TRANSPORT_HTTP
+
+#define MAX_DISTANCE_MM 2000 // 2m max for display scaling
+#define MIN_DISTANCE_MM 30   // Near-field gate, shorter echoes are clutter
 #define TRIGGER_GPIO 5
 #define ECHO_GPIO 18
 
+// Ambient conditions for speed-of-sound compensation
+#define AMBIENT_TEMP_C       20.0f
+#define AMBIENT_HUMIDITY_PCT 50.0f
+
+// Adaptive ping rate. Objects past the range gate can echo into the next
+// ping; raise the floor toward 24000 (4 m) in a reverberant room
+#define PING_RISE_US         500    // Trigger to echo start, burst and module latency
+#define PING_RINGDOWN_US     2000   // Transducer ring-down after the echo
+#define PING_MIN_INTERVAL_US 3000   // Floor between triggers, burst and ring-down of a 5 cm echo
+#define PING_MAX_INTERVAL_US 250000 // Back-off cap while the sensor does not answer
+#define PING_RISE_TIMEOUT_US 6000 // Trigger to echo start, device not responding after this
+
+// Scan head servo (LEDC), 500..2500us pulse sweeps 180 degrees
+#define SERVO_GPIO          19
+#define SERVO_MIN_PULSE_US  500
+#define SERVO_MAX_PULSE_US  2500
+#define SCAN_START_DEG      180
+#define SCAN_END_DEG        360
+#define SCAN_RESOLUTION_DEG 3 // Largest step between bearings
+
+// Servo motion model (SG90 class), see scan_plan.h
+#define SERVO_DEAD_US            10000 // Half a 20ms PWM frame on average
+#define SERVO_SLEW_US_PER_DEG    1700  // ~0.1s per 60 degrees
+#define SERVO_SETTLE_US          5000
+#define SERVO_SETTLE_US_PER_DEG2 200
+
+// Change-only mode: uplink and redraw only bins whose range moved, plus both
+// ends of every sweep. The server holds the last value per bin and replays it
+// for the bearings the head passed, see rpi_server/sweep_hold.py
+#define CHANGE_ONLY_MODE     1
+#define DELTA_THRESHOLD_MM   30
+#define DELTA_TIMEOUT_MS     30000 // Unchanged returns are re-sent this often
+#define DELTA_KEYFRAME_MS    60000 // Full sweep re-sent this often for resync
+
 // OLED Pins (HSPI / SPI2)
 #define OLED_HOST    SPI2_HOST
 #define OLED_MOSI    13
@@ -31,86 +88,87 @@
 #define OLED_DC      27
 #define OLED_RST     26
 
-// WiFi event group
-static EventGroupHandle_t s_wifi_event_group;
-#define WIFI_CONNECTED_BIT BIT0
+// Display panel on the OLED pins, one of the backends in components/display
+#define DISPLAY_PANEL_SSD1351 0
+#define DISPLAY_PANEL_ST7789  1
+#define DISPLAY_PANEL_ILI9341 2
+#define DISPLAY_PANEL         DISPLAY_PANEL_SSD1351
+#define DISPLAY_STATS_FRAMES  200 // Frame time log interval
 
 static const char *TAG = "radar_sensor";
 
-// Shared state
-volatile float current_distance_cm = -1.0;
-volatile int current_angle = 180;
-volatile bool wifi_connected = false;
+// One measured bearing, sensor_task -> display_task
+typedef struct
+{
+    int16_t angle;
+    uint8_t status;      // ultrasonic_ping_status_t
+    bool dirty;          // Reported to the server, the blip has to be redrawn
+    int32_t distance_mm; // -1 if nothing in range
+} scan_result_t;
+
+// Latest result per angle bin, sensor_task -> display_task. Each bin is
+// queued once in arrival order and drawn with its latest result, so a
+// renderer that falls behind skips superseded bearings instead of losing
+// new ones
+static scan_result_t scan_latest[SCAN_DELTA_MAX_BINS];
+static bool scan_queued[SCAN_DELTA_MAX_BINS];
+static uint16_t scan_order[SCAN_DELTA_MAX_BINS]; // Ring of queued bins
+static uint16_t scan_head, scan_count;
+static uint32_t scan_coalesced;                  // Results replaced before they were drawn
+static portMUX_TYPE scan_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t display_handle;
 
-static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+// Blip drawn per angle bin, -1 if none
+static int16_t blip_x[SCAN_DELTA_MAX_BINS];
+static int16_t blip_y[SCAN_DELTA_MAX_BINS];
+
+static void scan_post(uint16_t bin, const scan_result_t *result)
 {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        ESP_LOGI(TAG, "WiFi disconnected, reconnecting...");
-        wifi_connected = false;
-        esp_wifi_connect();
-    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        wifi_connected = true;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+    portENTER_CRITICAL(&scan_lock);
+    if (scan_queued[bin]) {
+        // A change not drawn yet stays pending under the newer range
+        bool dirty = scan_latest[bin].dirty;
+        scan_latest[bin] = *result;
+        scan_latest[bin].dirty |= dirty;
+        scan_coalesced++;
+    } else {
+        scan_latest[bin] = *result;
+        scan_queued[bin] = true;
+        scan_order[(scan_head + scan_count++) % SCAN_DELTA_MAX_BINS] = bin;
     }
+    portEXIT_CRITICAL(&scan_lock);
+
+    xTaskNotifyGive(display_handle);
 }
 
-void wifi_init(void)
+static bool scan_take(uint16_t *bin, scan_result_t *result)
 {
-    s_wifi_event_group = xEventGroupCreate();
-    
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
-    
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    
-    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL));
-    
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = WIFI_SSID,
-            .password = WIFI_PASS,
-        },
-    };
-    
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
-    
-    ESP_LOGI(TAG, "WiFi initialized. Connecting to %s...", WIFI_SSID);
-    xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT, false, true, portMAX_DELAY);
-}
+    bool res = false;
 
-void draw_circle(ssd1351_t *dev, int x0, int y0, int radius, uint16_t color) {
-    int x = radius;
-    int y = 0;
-    int err = 0;
-
-    while (x >= y) {
-        ssd1351_draw_pixel(dev, x0 + x, y0 + y, color);
-        ssd1351_draw_pixel(dev, x0 + y, y0 + x, color);
-        ssd1351_draw_pixel(dev, x0 - y, y0 + x, color);
-        ssd1351_draw_pixel(dev, x0 - x, y0 + y, color);
-        ssd1351_draw_pixel(dev, x0 - x, y0 - y, color);
-        ssd1351_draw_pixel(dev, x0 - y, y0 - x, color);
-        ssd1351_draw_pixel(dev, x0 + y, y0 - x, color);
-        ssd1351_draw_pixel(dev, x0 + x, y0 - y, color);
-
-        if (err <= 0) {
-            y += 1;
-            err += 2*y + 1;
-        }
-        if (err > 0) {
-            x -= 1;
-            err -= 2*x + 1;
-        }
+    portENTER_CRITICAL(&scan_lock);
+    if (scan_count) {
+        *bin = scan_order[scan_head];
+        scan_head = (scan_head + 1) % SCAN_DELTA_MAX_BINS;
+        scan_count--;
+        *result = scan_latest[*bin];
+        scan_queued[*bin] = false;
+        res = true;
     }
+    portEXIT_CRITICAL(&scan_lock);
+
+    return res;
+}
+
+static void delay_until_us(int64_t deadline_us)
+{
+    int64_t remaining = deadline_us - esp_timer_get_time();
+
+    // Sleep whole ticks, busy-wait the rest so the ping goes out when the head is still
+    if (remaining > portTICK_PERIOD_MS * 1000)
+        vTaskDelay(remaining / (portTICK_PERIOD_MS * 1000));
+    remaining = deadline_us - esp_timer_get_time();
+    if (remaining > 0)
+        esp_rom_delay_us(remaining);
 }
 
 void sensor_task(void *pvParameters)
@@ -122,120 +180,229 @@ void sensor_task(void *pvParameters)
 
     ultrasonic_init(&sensor);
 
+    scan_servo_t servo = {
+        .gpio = SERVO_GPIO,
+        .timer = LEDC_TIMER_0,
+        .channel = LEDC_CHANNEL_0,
+        .min_pulse_us = SERVO_MIN_PULSE_US,
+        .max_pulse_us = SERVO_MAX_PULSE_US,
+        .min_deg = SCAN_START_DEG,
+        .max_deg = SCAN_END_DEG,
+    };
+    ESP_ERROR_CHECK(scan_servo_init(&servo));
+
+    // Recompute whenever the ambient readings change
+    ultrasonic_conv_t conv;
+    ultrasonic_conv_init(&conv, AMBIENT_TEMP_C, AMBIENT_HUMIDITY_PCT);
+
+    ultrasonic_sched_config_t sched_cfg = {
+        .rise_us = PING_RISE_US,
+        .ringdown_us = PING_RINGDOWN_US,
+        .min_interval_us = PING_MIN_INTERVAL_US,
+        .max_interval_us = PING_MAX_INTERVAL_US,
+        .max_range_mm = MAX_DISTANCE_MM,
+    };
+    ultrasonic_sched_t sched;
+    ultrasonic_sched_init(&sched, &sched_cfg, &conv);
+
+    ultrasonic_gate_t gate = {
+        .min_time_us = ultrasonic_conv_mm_to_us(&conv, MIN_DISTANCE_MM),
+        .max_time_us = sched.echo_window_us,
+        .rise_timeout_us = PING_RISE_TIMEOUT_US,
+    };
+
+    scan_motion_t motion = {
+        .dead_us = SERVO_DEAD_US,
+        .slew_us_per_deg = SERVO_SLEW_US_PER_DEG,
+        .settle_us = SERVO_SETTLE_US,
+        .settle_us_per_deg2 = SERVO_SETTLE_US_PER_DEG2,
+    };
+    scan_plan_config_t plan_cfg = {
+        .start_deg = SCAN_START_DEG,
+        .end_deg = SCAN_END_DEG,
+        .resolution_deg = SCAN_RESOLUTION_DEG,
+        .listen_us = PING_RISE_US + sched.echo_window_us,
+        .min_interval_us = PING_MIN_INTERVAL_US,
+    };
+    const bool sweeping = plan_cfg.start_deg != plan_cfg.end_deg;
+    scan_seq_t seq;
+    scan_seq_init(&seq, &plan_cfg, &motion, esp_timer_get_time());
+    ESP_ERROR_CHECK(scan_servo_set(&servo, seq.bearing));
+    ESP_LOGI(TAG, "Scan plan: %u deg steps, %" PRIu32 " us period, %" PRIu32 " ms per sweep",
+             seq.plan.step_deg, seq.plan.period_us, seq.plan.sweep_us / 1000);
+
+    scan_delta_config_t delta_cfg = {
+        .start_deg = SCAN_START_DEG,
+        .bin_deg = 1,
+        .threshold_mm = DELTA_THRESHOLD_MM,
+        .timeout_ms = DELTA_TIMEOUT_MS,
+        .keyframe_ms = DELTA_KEYFRAME_MS,
+    };
+    static scan_delta_t delta;
+    scan_delta_init(&delta, &delta_cfg, esp_timer_get_time() / 1000);
+
     while (true)
     {
-        float distance;
-        esp_err_t res = ultrasonic_measure(&sensor, MAX_DISTANCE_CM, &distance);
-        if (res == ESP_OK) {
-            current_distance_cm = distance * 100; // Convert to cm
-            // printf("Dist: %.1f cm\n", current_distance_cm);
-        } else {
-            current_distance_cm = -1.0;
+        ultrasonic_ping_t ping;
+        uint32_t gap_us;
+
+        delay_until_us(scan_seq_trigger_time(&seq));
+        int64_t trig_us = esp_timer_get_time();
+        if (ultrasonic_measure_gated(&sensor, &gate, &ping) != ESP_OK) {
+            ping.status = ULTRASONIC_PING_NO_ECHO;
+        }
+        int64_t done_us = esp_timer_get_time();
+
+        scan_result_t result = {
+            .angle = seq.bearing,
+            .status = ping.status,
+            .distance_mm = -1,
+        };
+        switch (ping.status) {
+        case ULTRASONIC_PING_OK:
+            result.distance_mm = ultrasonic_conv_us_to_mm(&conv, ping.time_us);
+            gap_us = ultrasonic_sched_echo(&sched, ping.time_us);
+            break;
+        case ULTRASONIC_PING_NEAR:
+            // Line went quiet early, nothing in range past the clutter
+            gap_us = ultrasonic_sched_echo(&sched, ping.time_us);
+            break;
+        case ULTRASONIC_PING_FAR:
+            // A miss at one bearing says nothing about the next, back off only
+            // when the head is parked
+            gap_us = sweeping ? ultrasonic_sched_echo(&sched, gate.max_time_us) : ultrasonic_sched_timeout(&sched);
+            break;
+        default:
+            // Sensor not responding, the next bearing will not do better
+            gap_us = ultrasonic_sched_timeout(&sched);
+            break;
+        }
+
+        // Head may leave as soon as the echo is in
+        ESP_ERROR_CHECK(scan_servo_set(&servo, scan_seq_advance(&seq, trig_us, done_us, gap_us)));
+
+        // Sweep ends always go out, they tell the server where the head turned
+        uint16_t bin = scan_delta_bin(&delta, result.angle);
+        bool sweep_end = result.angle == plan_cfg.start_deg || result.angle == plan_cfg.end_deg;
+        result.dirty = scan_delta_update(&delta, result.angle, result.distance_mm, esp_timer_get_time() / 1000)
+            != SCAN_DELTA_SKIP || sweep_end || !CHANGE_ONLY_MODE;
+        scan_post(bin, &result);
+
+        // Unchanged bins are not sent. Submitted here rather than after
+        // rendering, so a slow panel never costs the server a bearing
+        if (result.dirty) {
+            uplink_sample_t sample = {
+                .angle = result.angle,
+                .distance_mm = result.distance_mm,
+            };
+            uplink_submit(&sample); // Buffered while offline
         }
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
 void display_task(void *pvParameters)
 {
-    ssd1351_t dev;
-    ESP_ERROR_CHECK(ssd1351_init(&dev, OLED_HOST, OLED_MOSI, OLED_CLK, OLED_CS, OLED_DC, OLED_RST));
-
-    ssd1351_fill_screen(&dev, COLOR_BLACK);
-
-    // Radar Center (Bottom Middle)
-    int cx = 64;
-    int cy = 110;
-    int max_radius = 60;
-
-    // Draw static grid (Semi-circles)
-    draw_circle(&dev, cx, cy, 20, 0x03E0); // Dark Green
-    draw_circle(&dev, cx, cy, 40, 0x03E0);
-    draw_circle(&dev, cx, cy, 60, 0x03E0);
-    // Horizontal line
-    ssd1351_draw_line(&dev, cx-60, cy, cx+60, cy, 0x03E0);
-    // Vertical line
-    ssd1351_draw_line(&dev, cx, cy, cx, cy-60, 0x03E0);
-    // Diagonal lines (45 and 135 degrees)
-    // 225 deg (Left-Up diagonal): cos(225)=-0.707, sin(225)=-0.707
-    // 315 deg (Right-Up diagonal): cos(315)=0.707, sin(315)=-0.707
-    ssd1351_draw_line(&dev, cx, cy, cx - 42, cy - 42, 0x03E0);
-    ssd1351_draw_line(&dev, cx, cy, cx + 42, cy - 42, 0x03E0);
-
-    int angle = 180;
-    int step = 2;
-    int prev_x = cx - 60, prev_y = cy;
+    display_spi_config_t spi_cfg = {
+        .host = OLED_HOST,
+        .mosi = OLED_MOSI,
+        .sclk = OLED_CLK,
+        .cs = OLED_CS,
+        .dc = OLED_DC,
+        .rst = OLED_RST,
+    };
+    static display_t disp;
+#if DISPLAY_PANEL == DISPLAY_PANEL_ST7789
+    ESP_ERROR_CHECK(display_st7789_init(&disp, &spi_cfg));
+#elif DISPLAY_PANEL == DISPLAY_PANEL_ILI9341
+    ESP_ERROR_CHECK(display_ili9341_init(&disp, &spi_cfg));
+#else
+    ESP_ERROR_CHECK(display_ssd1351_init(&disp, &spi_cfg));
+#endif
+
+    display_fill_screen(&disp, DISPLAY_BLACK);
+
+    // Radar half-disc scaled to the panel, center bottom middle
+    radar_view_t view;
+    radar_view_layout(&view, display_width(&disp), display_height(&disp));
+    radar_view_draw_grid(&disp, &view, DISPLAY_DARK_GREEN);
+    ESP_LOGI(TAG, "Display %s %ux%u, radius %d", disp.ops->name, display_width(&disp), display_height(&disp), view.radius);
+
+    memset(blip_x, 0xff, sizeof(blip_x));
+    memset(blip_y, 0xff, sizeof(blip_y));
+
+    int prev_angle = SCAN_START_DEG;
+    int prev_bin = 0;
+    bool first_frame = true;
     
     while (true)
     {
-        // Erase old sweep line
-        ssd1351_draw_line(&dev, cx, cy, prev_x, prev_y, COLOR_BLACK);
-        
-        // Redraw grid parts that might have been erased
-        draw_circle(&dev, cx, cy, 20, 0x03E0);
-        draw_circle(&dev, cx, cy, 40, 0x03E0);
-        draw_circle(&dev, cx, cy, 60, 0x03E0);
-        ssd1351_draw_line(&dev, cx-60, cy, cx+60, cy, 0x03E0);
-        ssd1351_draw_line(&dev, cx, cy, cx, cy-60, 0x03E0);
-        ssd1351_draw_line(&dev, cx, cy, cx - 42, cy - 42, 0x03E0);
-        ssd1351_draw_line(&dev, cx, cy, cx + 42, cy - 42, 0x03E0);
-
-        // Calculate new sweep line
-        // 180 (Left) -> 270 (Up) -> 360 (Right)
-        float rad = angle * M_PI / 180.0;
-        int x = cx + (int)(max_radius * cos(rad));
-        int y = cy + (int)(max_radius * sin(rad));
-
-        // Draw sweep line
-        ssd1351_draw_line(&dev, cx, cy, x, y, COLOR_GREEN);
-        prev_x = x;
-        prev_y = y;
-
-        // Update shared angle for UART transmission
-        current_angle = angle;
-
-        // Draw Blip at current angle if distance is valid
-        if (current_distance_cm > 0 && current_distance_cm < MAX_DISTANCE_CM) {
-            // Map distance to pixels
-            int r = (int)((current_distance_cm / MAX_DISTANCE_CM) * max_radius);
-            
-            // Calculate blip position along the CURRENT sweep line
-            int bx = cx + (int)(r * cos(rad));
-            int by = cy + (int)(r * sin(rad));
-            
-            // Draw a red blip
-            ssd1351_fill_rect(&dev, bx-2, by-2, 5, 5, COLOR_RED);
+        // Bearings arrive as the scan head measures them
+        scan_result_t result;
+        uint16_t bin;
+        while (!scan_take(&bin, &result))
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        display_frame_begin(&disp);
+
+        // Erase old sweep line and redraw the grid parts it covered
+        radar_view_erase_sweep(&disp, &view, prev_angle, DISPLAY_BLACK, DISPLAY_DARK_GREEN);
+
+        // Blips the old sweep line ran across
+        for (int b = prev_bin - 3; b <= prev_bin + 3; b++) {
+            if (b >= 0 && b < SCAN_DELTA_MAX_BINS && blip_x[b] >= 0)
+                radar_view_draw_blip(&disp, &view, blip_x[b], blip_y[b], DISPLAY_RED);
         }
 
-        // Send data to RPi via WiFi HTTP POST
-        if (wifi_connected) {
-            char post_data[64];
-            snprintf(post_data, sizeof(post_data), "{\"angle\":%d,\"distance\":%.1f}", angle, current_distance_cm);
-            
-            esp_http_client_config_t config = {
-                .url = RPI_SERVER_URL,
-                .method = HTTP_METHOD_POST,
-            };
-            
-            esp_http_client_handle_t client = esp_http_client_init(&config);
-            esp_http_client_set_header(client, "Content-Type", "application/json");
-            esp_http_client_set_post_field(client, post_data, strlen(post_data));
-            
-            esp_err_t err = esp_http_client_perform(client);
-            if (err != ESP_OK) {
-                ESP_LOGD(TAG, "HTTP POST failed: %s", esp_err_to_name(err));
+        // New sweep line at the measured bearing
+        // 180 (Left) -> 270 (Up) -> 360 (Right)
+        radar_view_draw_sweep(&disp, &view, result.angle, DISPLAY_GREEN);
+        prev_angle = result.angle;
+        prev_bin = bin;
+
+        if (result.dirty) {
+            if (blip_x[bin] >= 0) {
+                radar_view_draw_blip(&disp, &view, blip_x[bin], blip_y[bin], DISPLAY_BLACK);
+                blip_x[bin] = blip_y[bin] = -1;
+            }
+
+            // Blip along the current sweep line if distance is valid
+            if (result.distance_mm > 0 && result.distance_mm < MAX_DISTANCE_MM) {
+                int bx, by;
+                radar_view_point(&view, result.angle, (float)result.distance_mm / MAX_DISTANCE_MM, &bx, &by);
+                radar_view_draw_blip(&disp, &view, bx, by, DISPLAY_RED);
+                blip_x[bin] = bx;
+                blip_y[bin] = by;
             }
-            
-            esp_http_client_cleanup(client);
         }
 
-        // Update angle (Ping-Pong sweep)
-        angle += step;
-        if (angle >= 360 || angle <= 180) {
-            step = -step; // Reverse direction
+        display_frame_end(&disp);
+        if (first_frame) {
+            ESP_LOGI(TAG, "First frame rendered %" PRId64 " ms after boot", esp_timer_get_time() / 1000);
+            first_frame = false;
         }
+        if (disp.stats.frames == DISPLAY_STATS_FRAMES) {
+            portENTER_CRITICAL(&scan_lock);
+            uint32_t coalesced = scan_coalesced;
+            portEXIT_CRITICAL(&scan_lock);
+            ESP_LOGI(TAG, "Frame avg %" PRIu32 " us, max %" PRIu32 " us, max %" PRIu32 " windows / %" PRIu32 " bytes, %" PRIu32 " bearings coalesced",
+                     (uint32_t)(disp.stats.total_us / disp.stats.frames), disp.stats.max_us,
+                     disp.stats.max_windows, disp.stats.max_bytes, coalesced);
+            memset(&disp.stats, 0, sizeof(disp.stats));
+
+            uplink_stats_t up;
+            uplink_get_stats(&up);
+            ESP_LOGI(TAG, "Uplink sent %" PRIu32 ", drained %" PRIu32 ", dropped %" PRIu32 ", failed %" PRIu32 ", backlog lost %" PRIu32,
+                     up.sent, up.drained, up.dropped, up.failed, up.stored_dropped);
 
-        vTaskDelay(pdMS_TO_TICKS(10));
+            wifi_fsm_stats_t wifi;
+            wifi_link_get_stats(&wifi);
+            ESP_LOGI(TAG, "WiFi first up %" PRIu32 " ms, %" PRIu32 " fast / %" PRIu32 " scan connects, %" PRIu32 " fast failed, %" PRIu32 " cached IP / %" PRIu32 " DHCP, %" PRIu32 " fallbacks",
+                     wifi.first_up_ms, wifi.fast_connects, wifi.scan_connects, wifi.fast_failures,
+                     wifi.cached_ips, wifi.dhcp_leases, wifi.ip_fallbacks);
+            // Flat once running, the uplink and display allocate nothing per sample
+            ESP_LOGI(TAG, "Heap free %" PRIu32 ", min %" PRIu32, esp_get_free_heap_size(),
+                     esp_get_minimum_free_heap_size());
+        }
     }
 }
 
@@ -251,11 +418,33 @@ void app_main()
     }
     ESP_ERROR_CHECK(ret);
     
-    // Initialize WiFi
-    wifi_init();
-    
-    ESP_LOGI(TAG, "WiFi connected! Starting tasks...");
-    
-    xTaskCreate(sensor_task, "sensor_task", 2048, NULL, 5, NULL);
-    xTaskCreate(display_task, "display_task", 8192, NULL, 5, NULL);
+    uplink_config_t uplink_cfg = {
+        .transport = UPLINK_TRANSPORT,
+        .url = RPI_SERVER_URL,
+        .host = RPI_SERVER_IP,
+        .port = RPI_UDP_PORT,
+    };
+    ESP_ERROR_CHECK(uplink_init(&uplink_cfg));
+
+    ESP_LOGI(TAG, "Starting tasks...");
+
+    // Sensor and display start before WiFi, whose init takes a while. The
+    // display goes first, the sensor notifies it
+    xTaskCreate(display_task, "display_task", 8192, NULL, 5, &display_handle);
+    xTaskCreate(sensor_task, "sensor_task", 4096, NULL, 6, NULL); // Above display, pings are timed to the head
+
+    // Does not wait for the connection, samples are buffered until then
+    wifi_link_config_t wifi_cfg = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASS,
+        .static_ip = WIFI_STATIC_IP,
+        .gateway = WIFI_GATEWAY,
+        .netmask = WIFI_NETMASK,
+        .dns = WIFI_DNS,
+        .fast_connect = WIFI_FAST_CONNECT,
+        .reuse_lease = WIFI_REUSE_LEASE,
+        .verify_lease = true,
+        .on_link = uplink_set_connected,
+    };
+    ESP_ERROR_CHECK(wifi_link_start(&wifi_cfg));
 }
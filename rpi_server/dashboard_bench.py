@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""
+Headless browser benchmark of the multi-device dashboard.
+Loads /dashboard for each device count and reports the worker's frame time,
+frame rate and the page's event loop lag. Devices are synthesized in the
+page, or with --replay played from a trace by replay.py, so the server's
+ingest, batching and socket path are measured along with the page.
+
+Needs a running radar_server.py and Playwright:
+    pip3 install playwright && python3 -m playwright install chromium
+    python3 dashboard_bench.py --devices 1,4,16,64 --rate 50
+    python3 dashboard_bench.py --devices 1,4,16 --replay capture.rtrc --speed 4
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+from urllib.parse import urlparse
+
+
+def start_replay(url, trace, copies, speed):
+    """replay.py sending `copies` simulated devices per recorded one until stopped."""
+    script = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'replay.py')
+    return subprocess.Popen([sys.executable, script, trace, '--host', urlparse(url).hostname or '127.0.0.1',
+                             '--devices', str(copies), '--speed', f"{speed:g}", '--loops', '1000000'],
+                            stdout=subprocess.DEVNULL)
+
+
+def run(url, counts, rate, seconds, width, height, trace=None, speed=1.0):
+    try:
+        from playwright.sync_api import sync_playwright
+    except ImportError:
+        sys.exit("Playwright is not installed: pip3 install playwright && python3 -m playwright install chromium")
+
+    results = []
+    with sync_playwright() as pw:
+        browser = pw.chromium.launch()
+        page = browser.new_page(viewport={'width': width, 'height': height})
+        for n in counts:
+            replay = None
+            if trace is None:
+                page.goto(f"{url}/dashboard?synthetic={n}&rate={rate:g}")
+            else:
+                replay = start_replay(url, trace, n, speed)
+                page.goto(f"{url}/dashboard")
+            try:
+                # Warm up until every device is on screen, then measure
+                page.wait_for_function(f"window.radarStats && window.radarStats.devices >= {n}", timeout=30000)
+                page.wait_for_timeout(seconds * 1000)
+                stats = page.evaluate("window.radarStats")
+            finally:
+                if replay is not None:
+                    replay.terminate()
+                    replay.wait()
+            results.append((n, stats))
+            print(f"{n:4d} devices: {stats['avgMs']:6.2f} ms avg, {stats['p95Ms']:6.2f} ms p95, "
+                  f"{stats['maxMs']:6.2f} ms max, {stats['fps']:5.1f} fps, "
+                  f"{stats['samplesPerSec']:7.0f} samples/s, main thread lag {stats['mainLagMs']:.1f} ms")
+        browser.close()
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Dashboard frame time against device count')
+    parser.add_argument('--url', default='http://localhost:5000', help='radar_server.py address')
+    parser.add_argument('--devices', default='1,4,16,64', help='Comma-separated device counts')
+    parser.add_argument('--rate', type=float, default=50.0, help='Samples per second per device')
+    parser.add_argument('--replay', metavar='TRACE',
+                        help='Play this trace with replay.py instead of synthesizing devices in the page; '
+                             'each device count is copies per recorded device')
+    parser.add_argument('--speed', type=float, default=1.0, help='Replay speed factor (default: 1)')
+    parser.add_argument('--seconds', type=float, default=5.0, help='Measuring time per device count')
+    parser.add_argument('--width', type=int, default=1440)
+    parser.add_argument('--height', type=int, default=900)
+    args = parser.parse_args()
+
+    counts = [int(n) for n in args.devices.split(',') if n]
+    run(args.url.rstrip('/'), counts, args.rate, args.seconds, args.width, args.height, args.replay, args.speed)
+
+
+if __name__ == '__main__':
+    main()
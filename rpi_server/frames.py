@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+Batched binary frames for the multi-device dashboard.
+Live samples from every device are collected and broadcast as one binary
+WebSocket message per interval instead of one JSON event per sample, so the
+browser handles a few messages per second regardless of device count and can
+hand each one to its render worker as a transferable buffer.
+
+Frame layout (little-endian), decoded by static/radar_worker.js:
+    header: magic u16, version u8, reserved u8, count u16, dropped u16, server time ms u32
+    record: device u32, angle i16, distance mm i16 (-1 = no echo)
+
+Measure encode cost and size against per-sample JSON events:
+    python3 frames.py --devices 32 --rate 50
+"""
+
+from collections import deque
+import struct
+import threading
+import time
+
+MAGIC = 0x5246
+VERSION = 1
+HEADER = struct.Struct('<HBBHHI')
+RECORD = struct.Struct('<Ihh')
+
+FRAME_INTERVAL_S = 0.05
+# Records per frame; a frame over this drops its oldest samples
+MAX_RECORDS = 4096
+
+
+def encode_frame(records, dropped=0, now_ms=None):
+    """Build a frame; records are (device, angle, distance_mm) tuples."""
+    now_ms = int(time.time() * 1000) if now_ms is None else now_ms
+    buf = bytearray(HEADER.size + len(records) * RECORD.size)
+    HEADER.pack_into(buf, 0, MAGIC, VERSION, 0, len(records), min(dropped, 0xFFFF), now_ms & 0xFFFFFFFF)
+    offset = HEADER.size
+    pack = RECORD.pack_into
+    for device, angle, distance_mm in records:
+        pack(buf, offset, device & 0xFFFFFFFF, angle, distance_mm)
+        offset += RECORD.size
+    return bytes(buf)
+
+
+def distance_mm(distance_cm):
+    if distance_cm <= 0:
+        return -1
+    return min(int(distance_cm * 10 + 0.5), 0x7FFF)
+
+
+class FrameBatcher:
+    """Collects live samples and emits them as one frame per interval."""
+
+    def __init__(self, interval=FRAME_INTERVAL_S, max_records=MAX_RECORDS):
+        self.interval = interval
+        self.max_records = max_records
+        self.pending = deque()
+        self.dropped = 0
+        self.dropped_total = 0
+        self.frames = 0
+        self.lock = threading.Lock()
+
+    def add(self, device, angle, distance_cm):
+        with self.lock:
+            if len(self.pending) >= self.max_records:
+                self.pending.popleft()
+                self.dropped += 1
+                self.dropped_total += 1
+            self.pending.append((device, int(angle), distance_mm(distance_cm)))
+
+    def flush(self):
+        """Frame of everything added since the last flush, None if nothing was."""
+        with self.lock:
+            if not self.pending:
+                return None
+            records, self.pending = self.pending, deque()
+            dropped, self.dropped = self.dropped, 0
+        self.frames += 1
+        return encode_frame(records, dropped)
+
+    def run(self, socketio, emit=None, event='radar_frame'):
+        """Background task: broadcast a frame every interval through `emit(event, frame)`."""
+        emit = emit or socketio.emit
+        while True:
+            socketio.sleep(self.interval)
+            frame = self.flush()
+            if frame is not None:
+                emit(event, frame)
+
+
+def main():
+    import argparse
+    import json
+    import random
+
+    parser = argparse.ArgumentParser(description='Dashboard frame encode benchmark')
+    parser.add_argument('--devices', type=int, default=16)
+    parser.add_argument('--rate', type=float, default=50.0, help='Samples per second per device')
+    parser.add_argument('--seconds', type=float, default=10.0, help='Simulated duration')
+    args = parser.parse_args()
+
+    batcher = FrameBatcher()
+    per_frame = max(1, int(args.devices * args.rate * batcher.interval))
+    frames = int(args.seconds / batcher.interval)
+    frame_bytes = 0
+
+    start = time.perf_counter()
+    for f in range(frames):
+        for i in range(per_frame):
+            batcher.add(i % args.devices, 180 + (f * per_frame + i) % 181, random.uniform(-1, 200))
+        frame_bytes += len(batcher.flush())
+    elapsed = time.perf_counter() - start
+
+    # What the per-sample radar_update events would have carried
+    sample = {'angle': 270, 'distance': 123.4, 'timestamp': time.time()}
+    json_bytes = len(json.dumps(sample)) * per_frame * frames
+
+    total = per_frame * frames
+    print(f"{args.devices} devices x {args.rate:.0f} samples/s: {1 / batcher.interval:.0f} frames/s "
+          f"of {per_frame} samples instead of {args.devices * args.rate:.0f} events/s")
+    print(f"{elapsed / total * 1e6:.2f} us/sample batch+encode, {frame_bytes / total:.1f} bytes/sample "
+          f"({json_bytes / total:.1f} as JSON events)")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Multi-resolution history summaries.
+Every sample updates, per device and angle bin, a 1 s, a 1 min and a 1 h
+bucket holding the sample and hit counts and the min/max/mean range of the
+hits. Each level keeps a fixed number of buckets, so a query over any window
+reads at most a point budget's worth of buckets from the coarsest level that
+still meets the requested resolution.
+
+Measure query cost over a synthetic day of data:
+    python3 history.py --hours 24
+"""
+
+import heapq
+import threading
+import time
+
+ANGLE_BIN_DEG = 6
+
+# (bucket seconds, buckets kept): 1 h of seconds, 1 day of minutes, 30 days of hours
+LEVELS = ((1, 3600), (60, 1440), (3600, 720))
+
+MAX_BUCKETS = 500
+
+
+class _Level:
+    __slots__ = ('seconds', 'keep', 'buckets', 'order', 'newest')
+
+    def __init__(self, seconds, keep):
+        self.seconds = seconds
+        self.keep = keep
+        self.buckets = {}
+        self.order = []
+        self.newest = None
+
+    def add(self, t, angle_bin, distance):
+        idx = int(t // self.seconds)
+        bucket = self.buckets.get(idx)
+        if bucket is None:
+            if self.newest is not None and idx <= self.newest - self.keep:
+                # Backlog older than this level retains
+                return
+            bucket = self.buckets[idx] = {}
+            heapq.heappush(self.order, idx)
+            if self.newest is None or idx > self.newest:
+                self.newest = idx
+                while self.order[0] <= idx - self.keep:
+                    del self.buckets[heapq.heappop(self.order)]
+
+        s = bucket.get(angle_bin)
+        if s is None:
+            # samples, hits, min, max, sum of hit ranges
+            s = bucket[angle_bin] = [0, 0, 0.0, 0.0, 0.0]
+        s[0] += 1
+        if distance > 0:
+            if s[1] == 0:
+                s[2] = s[3] = distance
+            elif distance < s[2]:
+                s[2] = distance
+            elif distance > s[3]:
+                s[3] = distance
+            s[1] += 1
+            s[4] += distance
+
+    def query(self, start, end):
+        out = []
+        buckets = self.buckets
+        if not buckets:
+            return out
+        # Only the retained buckets, at most `keep` of them whatever the window
+        first = max(int(start // self.seconds), self.order[0])
+        last = min(int(end // self.seconds), self.newest)
+        for idx in range(first, last + 1):
+            bucket = buckets.get(idx)
+            if bucket is None:
+                continue
+            out.append({
+                't': idx * self.seconds,
+                'bins': [[b * ANGLE_BIN_DEG, s[0], s[1], round(s[2], 1), round(s[3], 1),
+                          round(s[4] / s[1], 1) if s[1] else None]
+                         for b, s in sorted(bucket.items())]
+            })
+        return out
+
+
+class HistoryLOD:
+    """Per-device summary levels, fed from the ingest path."""
+
+    def __init__(self, levels=LEVELS):
+        self.level_spec = levels
+        self.devices = {}
+        self.clock = {}
+        self.lock = threading.Lock()
+
+    def sample_time(self, device, sample, live):
+        """Wall time the sample was taken.
+
+        Live samples are stamped on arrival and calibrate the device clock
+        (ms since boot) per boot; backlog samples from a calibrated boot are
+        placed back where they were measured, not where they arrived.
+        """
+        ts = sample['timestamp']
+        device_ts = sample.get('device_ts')
+        if device_ts is None:
+            return ts
+        key = (device, sample.get('boot', 0))
+        if live:
+            self.clock[key] = ts - device_ts / 1000.0
+            return ts
+        offset = self.clock.get(key)
+        return ts if offset is None else offset + device_ts / 1000.0
+
+    def add(self, device, sample, live=True):
+        with self.lock:
+            t = self.sample_time(device, sample, live)
+            levels = self.devices.get(device)
+            if levels is None:
+                levels = self.devices[device] = [_Level(sec, keep) for sec, keep in self.level_spec]
+            angle_bin = int(sample['angle']) // ANGLE_BIN_DEG
+            for level in levels:
+                level.add(t, angle_bin, sample['distance'])
+
+    def pick_level(self, start, end, resolution=None, max_buckets=MAX_BUCKETS):
+        """Index of the coarsest level no coarser than `resolution` seconds,
+        made coarser still if the window would exceed `max_buckets`."""
+        span = max(end - start, 0.0)
+        chosen = 0
+        if resolution is not None:
+            for i, (seconds, keep) in enumerate(self.level_spec):
+                if seconds > resolution:
+                    break
+                chosen = i
+        # Finer levels only remember so much; do not pick one that lost the window start
+        while chosen + 1 < len(self.level_spec):
+            seconds, keep = self.level_spec[chosen]
+            if span / seconds <= max_buckets and time.time() - start <= seconds * keep:
+                break
+            chosen += 1
+        return chosen
+
+    def query(self, start, end, resolution=None, device=None, max_buckets=MAX_BUCKETS):
+        i = self.pick_level(start, end, resolution, max_buckets)
+        seconds = self.level_spec[i][0]
+        with self.lock:
+            devices = self.devices if device is None else {device: self.devices.get(device)}
+            return {
+                'resolution': seconds,
+                'bin_deg': ANGLE_BIN_DEG,
+                'devices': {str(dev): levels[i].query(start, end)
+                            for dev, levels in devices.items() if levels is not None}
+            }
+
+
+def main():
+    import argparse
+    import random
+
+    parser = argparse.ArgumentParser(description='History summary query benchmark')
+    parser.add_argument('--hours', type=float, default=24.0, help='Synthetic history length')
+    parser.add_argument('--rate', type=float, default=20.0, help='Samples per second')
+    args = parser.parse_args()
+
+    lod = HistoryLOD()
+    now = time.time()
+    t0 = now - args.hours * 3600
+    total = int(args.hours * 3600 * args.rate)
+    start = time.perf_counter()
+    for i in range(total):
+        angle = 180 + i % 180
+        lod.add(1, {'angle': angle, 'distance': random.uniform(5, 200), 'timestamp': t0 + i / args.rate})
+    ingest_us = (time.perf_counter() - start) / total * 1e6
+    print(f"{total} samples over {args.hours:g} h, {ingest_us:.2f} us/sample ingest")
+
+    for window in (60, 3600, 6 * 3600, args.hours * 3600):
+        start = time.perf_counter()
+        result = lod.query(now - window, now)
+        elapsed = (time.perf_counter() - start) * 1e3
+        buckets = len(result['devices'].get('1', []))
+        print(f"window {window / 3600:6.2f} h: {result['resolution']:4d} s level, "
+              f"{buckets} buckets, {elapsed:.2f} ms")
+
+
+if __name__ == '__main__':
+    main()
@@ -4,9 +4,21 @@ Raspberry Pi Flask Server for Ultrasonic Radar Visualization
 Receives angle and distance data from ESP32 via WiFi HTTP POST and displays it on a web dashboard.
 """
 
-from flask import Flask, render_template, jsonify, request
-from flask_socketio import SocketIO
+from flask import Flask, Response, render_template, jsonify, request
+from flask_socketio import SocketIO, join_room
+from collections import deque
+from udp_stream import UdpReceiver
+from radar_trace import TraceWriter
+from tracker import Tracker
+from sweep_hold import SweepHold
+from spatial import GridIndex, Pose, point_dict
+from history import HistoryLOD
+from frames import FrameBatcher, FRAME_INTERVAL_S
+from metrics import Registry, ClockOffset, DURATION_BUCKETS, register_process_metrics
+import argparse
+import atexit
 import json
+import threading
 import time
 
 app = Flask(__name__)
@@ -19,20 +31,235 @@ radar_data = {
     'timestamp': time.time()
 }
 
+# Every accepted sample, live or replayed from the ESP32 offline backlog
+HISTORY_SIZE = 100000
+history = deque(maxlen=HISTORY_SIZE)
+
+# 1 s / 1 min / 1 h per-angle summaries of the same samples, see history.py
+history_lod = HistoryLOD()
+
+
+class SampleDeduplicator:
+    """Recognizes repeated and late samples by their (device, boot, seq) stamp.
+
+    The ESP32 re-sends part of its flash backlog after a reboot, so the
+    same sample can arrive twice. Samples older than the newest one seen
+    for the same boot are backlog and must not move the live view.
+    """
+
+    def __init__(self, window=HISTORY_SIZE):
+        self.window = window
+        self.seen = set()
+        self.order = deque()
+        self.latest = {}
+
+    def check(self, device, boot, seq):
+        """Return 'duplicate', 'backlog' or 'live'."""
+        key = (device, boot, seq)
+        if key in self.seen:
+            return 'duplicate'
+
+        self.seen.add(key)
+        self.order.append(key)
+        if len(self.order) > self.window:
+            self.seen.discard(self.order.popleft())
+
+        if seq <= self.latest.get((device, boot), -1):
+            return 'backlog'
+        self.latest[(device, boot)] = seq
+        return 'live'
+
+
+dedup = SampleDeduplicator()
+
+# Samples arrive on Flask request threads and the UDP receiver thread at once;
+# de-duplication, history and tracking are updated under this one lock. Events
+# are only built under it and emitted after, a slow client never holds it
+ingest_lock = threading.Lock()
+udp_receiver = None
+recorder = None
+
+# Per-device trackers and their latest target lists
+trackers = {}
+targets = {}
+
+# Per-device last value per bearing, replays the bearings change-only devices
+# leave out so every stage below sees full sweeps, see sweep_hold.py
+holds = {}
+
+# Node poses and the shared world map, see spatial.py
+poses = {}
+world_map = GridIndex()
+DEFAULT_POSE = Pose()
+
+# Live samples of all devices, broadcast as one binary frame per interval for /dashboard
+frame_batcher = FrameBatcher()
+
+# Prometheus metrics at /metrics, see metrics.py
+registry = Registry()
+m_samples = registry.counter('radar_samples_total', 'Samples received, by kind: live, backlog or duplicate',
+                             ('device', 'transport', 'kind'))
+m_requests = registry.counter('radar_http_requests_total', 'POSTs to /api/radar, by result', ('status',))
+m_decode = registry.histogram('radar_decode_seconds', 'Time to decode one HTTP request or UDP datagram',
+                              DURATION_BUCKETS, ('transport',))
+m_ingest = registry.histogram('radar_ingest_seconds', 'Time to ingest one sample: tracking under the ingest lock, then the broadcast',
+                              DURATION_BUCKETS)
+m_broadcast = registry.histogram('radar_broadcast_seconds', 'Time to emit one WebSocket event to its clients',
+                                 DURATION_BUCKETS, ('event',))
+m_device_latency = registry.histogram('radar_device_to_server_seconds',
+                                      'Live sample device time to server arrival, above the fastest seen per boot',
+                                      labelnames=('device',))
+m_client_latency = registry.histogram('radar_server_to_client_seconds',
+                                      'Dashboard frame server time to receipt, as reported by the dashboards')
+device_clock = ClockOffset()
+
+clients_lock = threading.Lock()
+clients_connected = 0
+
+# Per-sample events only go to the single-radar view (index.html connects
+# with ?view=live); /dashboard draws from the batched radar_frame events
+LIVE_ROOM = 'live'
+
+
+def emit(event, data, to=None):
+    """Broadcast to all connected clients or the `to` room, timed."""
+    start = time.perf_counter()
+    socketio.emit(event, data, to=to)
+    m_broadcast.observe(time.perf_counter() - start, (event,))
+
+
+def register_server_metrics():
+    """Gauges and counters kept elsewhere, read when /metrics is scraped."""
+    registry.callback('radar_clients_connected', 'Connected WebSocket clients', 'gauge', lambda: clients_connected)
+    registry.callback('radar_live_age_seconds', 'Time since the last live sample arrived', 'gauge',
+                      lambda: time.time() - radar_data['timestamp'])
+    registry.callback('radar_frame_pending_samples', 'Samples waiting for the next dashboard frame', 'gauge',
+                      lambda: len(frame_batcher.pending))
+    registry.callback('radar_frames_sent_total', 'Dashboard frames broadcast', 'counter',
+                      lambda: frame_batcher.frames)
+    registry.callback('radar_frame_dropped_total', 'Samples dropped from full dashboard frames', 'counter',
+                      lambda: frame_batcher.dropped_total)
+    registry.callback('radar_history_samples', 'Raw samples held for /api/history', 'gauge', lambda: len(history))
+    registry.callback('radar_map_points', 'Points in the world map', 'gauge', lambda: len(world_map))
+
+    def udp(key):
+        if udp_receiver is None:
+            return []
+        return [((dev,), s[key]) for dev, s in udp_receiver.snapshot()['devices'].items()]
+
+    registry.callback('radar_udp_datagrams_total', 'UDP datagrams received', 'counter',
+                      lambda: udp('datagrams'), ('device',))
+    registry.callback('radar_udp_lost_total', 'UDP datagrams lost in transit', 'counter',
+                      lambda: udp('lost'), ('device',))
+    registry.callback('radar_udp_reordered_total', 'UDP datagrams received out of order', 'counter',
+                      lambda: udp('reordered'), ('device',))
+    registry.callback('radar_udp_duplicates_total', 'UDP datagrams received twice', 'counter',
+                      lambda: udp('duplicates'), ('device',))
+    registry.callback('radar_udp_malformed_total', 'UDP datagrams that did not decode', 'counter',
+                      lambda: udp_receiver.malformed if udp_receiver else 0)
+    registry.callback('radar_udp_injected_drops_total', 'UDP datagrams dropped by --udp-drop', 'counter',
+                      lambda: udp_receiver.injected_drops if udp_receiver else 0)
+    register_process_metrics(registry)
+
+
+register_server_metrics()
+
+
+def ingest_sample(device, sample, transport='http'):
+    """Common path for samples from every transport.
+
+    `sample` holds angle and distance (cm), plus boot, seq and device_ts
+    when the firmware stamps its samples. Returns False for duplicates.
+    """
+    start = time.perf_counter()
+    events = []
+    with ingest_lock:
+        accepted = _ingest_sample(device, sample, transport, events)
+    for event, data in events:
+        emit(event, data, to=LIVE_ROOM)
+    m_ingest.observe(time.perf_counter() - start)
+    return accepted
+
+
+def _ingest_sample(device, sample, transport, events):
+    """Ingest under `ingest_lock`, appending the live view's (event, data) to `events`."""
+    sample['device'] = device
+    sample['timestamp'] = time.time()
+    if recorder is not None:
+        recorder.write(sample)
+
+    # Older firmware sends no sequence numbers, treat everything as live
+    kind = 'live'
+    if sample.get('seq') is not None:
+        kind = dedup.check(device, sample.get('boot', 0), sample['seq'])
+        if kind == 'duplicate':
+            m_samples.inc((device, transport, kind))
+            return False
+    m_samples.inc((device, transport, kind))
+    history.append(sample)
+    history_lod.add(device, sample, kind == 'live')
+
+    if kind == 'live':
+        if sample.get('device_ts') is not None:
+            latency = device_clock.latency((device, sample.get('boot', 0)), sample['device_ts'], sample['timestamp'])
+            m_device_latency.observe(latency, (device,))
+
+        hold = holds.get(device)
+        if hold is None:
+            hold = holds[device] = SweepHold()
+        t = sample['timestamp']
+        expanded = hold.expand(sample['angle'], sample['distance'], t)
+        for angle, distance in expanded[:-1]:
+            # Held bearing the head passed, counts as seen again this sweep
+            history_lod.add(device, {'angle': angle, 'distance': distance, 'timestamp': t})
+            _apply_live(device, angle, distance, t, events)
+        _apply_live(device, sample['angle'], sample['distance'], t, events)
+    return True
+
+
+def _apply_live(device, angle, distance, t, events):
+    """Live view, map and tracking for one bearing, reported or held."""
+    radar_data['angle'] = angle
+    radar_data['distance'] = distance
+    radar_data['timestamp'] = t
+
+    events.append(('radar_update', dict(radar_data)))
+    frame_batcher.add(device, angle, distance)
+
+    if distance > 0:
+        x, y = poses.get(device, DEFAULT_POSE).project(angle, distance)
+        world_map.insert(x, y, t, device)
+
+    tracker = trackers.get(device)
+    if tracker is None:
+        tracker = trackers[device] = Tracker()
+    result = tracker.add(angle, distance, t)
+    if result is not None:
+        targets[device] = result
+        events.append(('radar_targets', {'device': device, 'targets': result}))
+
+
 @app.route('/api/radar', methods=['POST'])
 def receive_radar_data():
     """API endpoint to receive radar data from ESP32 via WiFi."""
     try:
-        data = request.get_json()
-        radar_data['angle'] = data.get('angle', 180)
-        radar_data['distance'] = data.get('distance', -1.0)
-        radar_data['timestamp'] = time.time()
-        
-        # Broadcast to all connected clients
-        socketio.emit('radar_update', radar_data)
+        with m_decode.time(('http',)):
+            data = request.get_json()
+            sample = {
+                'angle': data.get('angle', 180),
+                'distance': data.get('distance', -1.0),
+                'boot': data.get('boot', 0),
+                'seq': data.get('seq'),
+                'device_ts': data.get('ts')
+            }
+        if not ingest_sample(data.get('dev', 0), sample):
+            m_requests.inc(('duplicate',))
+            return jsonify({'status': 'duplicate'}), 200
         
+        m_requests.inc(('success',))
         return jsonify({'status': 'success'}), 200
     except Exception as e:
+        m_requests.inc(('error',))
         print(f"Error receiving data: {e}")
         return jsonify({'status': 'error', 'message': str(e)}), 400
 
@@ -52,8 +279,7 @@ def read_serial():
                     radar_data['distance'] = data.get('distance', -1.0)
                     radar_data['timestamp'] = time.time()
                     
-                    # Broadcast to all connected clients
-                    socketio.emit('radar_update', radar_data)
+                    socketio.emit('radar_update', radar_data, to=LIVE_ROOM)
                     
             except json.JSONDecodeError:
                 print(f"Invalid JSON: {line}")
@@ -69,12 +295,152 @@ def index():
     """Serve the main dashboard page."""
     return render_template('index.html')
 
+@app.route('/dashboard')
+def dashboard():
+    """Serve the multi-device grid dashboard, rendered in a Web Worker."""
+    return render_template('dashboard.html')
+
 @app.route('/api/data')
 def get_data():
     """API endpoint to get current radar data."""
     return jsonify(radar_data)
 
+@app.route('/api/history')
+def get_history():
+    """API endpoint to get history.
+
+    With `window` (seconds back from now) or `start`/`end` (epoch seconds),
+    returns per-angle summaries from the coarsest level that meets
+    `resolution` (seconds per bucket). Otherwise returns the most recent raw
+    samples in device order, including backlog.
+    """
+    if 'window' in request.args or 'start' in request.args:
+        end = request.args.get('end', time.time(), type=float)
+        start = request.args.get('start', end - request.args.get('window', 3600, type=float), type=float)
+        resolution = request.args.get('resolution', type=float)
+        device = request.args.get('device', type=int)
+        return jsonify(history_lod.query(start, end, resolution, device))
+
+    limit = request.args.get('limit', 1000, type=int)
+    with ingest_lock:
+        samples = list(history)[-limit:]
+    samples.sort(key=lambda s: (s['device'], s.get('boot', 0), s.get('seq') or 0))
+    return jsonify(samples)
+
+@app.route('/api/targets')
+def get_targets():
+    """API endpoint to get the tracked targets of the last sweep, per device."""
+    with ingest_lock:
+        current = {str(dev): t for dev, t in targets.items()}
+    return jsonify(current)
+
+@app.route('/api/devices/<int:device>/pose', methods=['GET', 'POST'])
+def device_pose(device):
+    """API endpoint to get or set a node's position (cm) and heading (degrees)."""
+    if request.method == 'POST':
+        data = request.get_json(silent=True) or {}
+        try:
+            poses[device] = Pose(data.get('x', 0.0), data.get('y', 0.0), data.get('heading', 90.0))
+        except (TypeError, ValueError) as e:
+            return jsonify({'status': 'error', 'message': str(e)}), 400
+    return jsonify(poses.get(device, DEFAULT_POSE).to_dict())
+
+@app.route('/api/map/region')
+def map_region():
+    """API endpoint to get the world-frame points inside a rectangle (cm)."""
+    try:
+        x0, y0, x1, y1 = (float(request.args[k]) for k in ('x0', 'y0', 'x1', 'y1'))
+    except (KeyError, ValueError):
+        return jsonify({'status': 'error', 'message': 'x0, y0, x1 and y1 are required'}), 400
+    limit = request.args.get('limit', 5000, type=int)
+    points = world_map.region(x0, y0, x1, y1)
+    return jsonify([point_dict(p) for p in points[-limit:]])
+
+@app.route('/api/map/nearest')
+def map_nearest():
+    """API endpoint to get the k world-frame points nearest to (x, y)."""
+    try:
+        x, y = float(request.args['x']), float(request.args['y'])
+    except (KeyError, ValueError):
+        return jsonify({'status': 'error', 'message': 'x and y are required'}), 400
+    k = max(1, min(request.args.get('k', 1, type=int), 100))
+    max_dist = request.args.get('max_dist', type=float)
+    found = world_map.nearest(x, y, k, max_dist)
+    return jsonify([dict(point_dict(p), dist=round(d, 1)) for d, p in found])
+
+@app.route('/metrics')
+def get_metrics():
+    """Prometheus scrape endpoint: ingest, broadcast, latency and process metrics."""
+    return Response(registry.render(), mimetype='text/plain; version=0.0.4')
+
+@socketio.on('connect')
+def client_connect():
+    global clients_connected
+    if request.args.get('view') == 'live':
+        join_room(LIVE_ROOM)
+    with clients_lock:
+        clients_connected += 1
+
+@socketio.on('disconnect')
+def client_disconnect():
+    global clients_connected
+    with clients_lock:
+        clients_connected -= 1
+
+@socketio.on('client_stats')
+def client_stats(data):
+    """Frame latencies measured by a /dashboard page since its last report, ms."""
+    for ms in (data or {}).get('latency_ms', [])[:1000]:
+        try:
+            # Clocks are only NTP-close; a frame cannot arrive before it was sent
+            m_client_latency.observe(max(float(ms), 0.0) / 1000.0)
+        except (TypeError, ValueError):
+            break
+
+@app.route('/api/udp/stats')
+def get_udp_stats():
+    """API endpoint to get per-device loss, reordering and latency of the UDP stream."""
+    if udp_receiver is None:
+        return jsonify({'status': 'error', 'message': 'UDP transport disabled'}), 404
+    return jsonify(udp_receiver.snapshot())
+
 if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Radar dashboard server')
+    parser.add_argument('--udp-port', type=int, default=5001,
+                        help='UDP datagram port, 0 to disable (default: 5001)')
+    parser.add_argument('--udp-drop', type=float, default=0.0,
+                        help='Fraction of UDP datagrams to drop on arrival, for loss testing')
+    parser.add_argument('--record', metavar='PATH',
+                        help='Record every incoming sample to a trace file for replay.py')
+    parser.add_argument('--poses', metavar='PATH',
+                        help='JSON file of node poses: {"<device id>": {"x": cm, "y": cm, "heading": deg}}')
+    parser.add_argument('--frame-ms', type=float, default=FRAME_INTERVAL_S * 1000,
+                        help='Batching interval of the /dashboard binary frames (default: 50)')
+    parser.add_argument('--no-metrics', action='store_true',
+                        help='Do not count per-sample metrics, for measuring their overhead')
+    args = parser.parse_args()
+    registry.enabled = not args.no_metrics
+
+    if args.poses:
+        with open(args.poses) as f:
+            for dev, p in json.load(f).items():
+                poses[int(dev, 0)] = Pose(p.get('x', 0.0), p.get('y', 0.0), p.get('heading', 90.0))
+        print(f"Loaded {len(poses)} node pose(s) from {args.poses}")
+
+    if args.record:
+        recorder = TraceWriter(args.record)
+        atexit.register(recorder.close)
+        print(f"Recording samples to {args.record}")
+
+    if args.udp_port:
+        udp_receiver = UdpReceiver(args.udp_port, lambda dev, sample: ingest_sample(dev, sample, 'udp'),
+                                   drop_rate=args.udp_drop, decode_seconds=m_decode)
+        udp_receiver.start()
+        print(f"Listening for UDP radar datagrams on port {args.udp_port}")
+
+    frame_batcher.interval = args.frame_ms / 1000.0
+    socketio.start_background_task(frame_batcher.run, socketio, emit)
+
     # Start Flask server
     print("Starting Radar Dashboard Server...")
     print("Open http://localhost:5000 in your browser")
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Compact binary recording of the raw radar sample stream.
+
+File layout: 8-byte header (magic b'RTRC', version u16, record size u16)
+followed by fixed-size little-endian records:
+    capture time f64 (server clock, s), device u32, device time u32 (ms),
+    seq u32 (0xFFFFFFFF if unknown), boot u16, angle i16, distance i32 (mm, -1 if none)
+"""
+
+import struct
+import threading
+
+MAGIC = b'RTRC'
+VERSION = 1
+HEADER = struct.Struct('<4sHH')
+RECORD = struct.Struct('<dIIIHhi')
+NO_SEQ = 0xFFFFFFFF
+
+
+def pack_sample(sample):
+    """Encode one ingested sample dict as a trace record."""
+    distance = sample.get('distance', -1.0)
+    seq = sample.get('seq')
+    return RECORD.pack(
+        sample['timestamp'],
+        sample.get('device', 0) & 0xFFFFFFFF,
+        (sample.get('device_ts') or 0) & 0xFFFFFFFF,
+        NO_SEQ if seq is None else seq & 0xFFFFFFFF,
+        sample.get('boot', 0) & 0xFFFF,
+        int(sample['angle']),
+        int(round(distance * 10)) if distance > 0 else -1
+    )
+
+
+def unpack_record(data, offset=0):
+    """Decode one trace record into a sample dict."""
+    ts, device, device_ts, seq, boot, angle, distance_mm = RECORD.unpack_from(data, offset)
+    return {
+        'timestamp': ts,
+        'device': device,
+        'device_ts': device_ts,
+        'seq': None if seq == NO_SEQ else seq,
+        'boot': boot,
+        'angle': angle,
+        'distance': distance_mm / 10.0 if distance_mm >= 0 else -1.0
+    }
+
+
+class TraceWriter:
+    """Appends samples to a trace file; safe to call from several threads."""
+
+    def __init__(self, path, flush_every=256):
+        self.file = open(path, 'wb')
+        self.file.write(HEADER.pack(MAGIC, VERSION, RECORD.size))
+        self.flush_every = flush_every
+        self.pending = []
+        self.count = 0
+        self.lock = threading.Lock()
+
+    def write(self, sample):
+        record = pack_sample(sample)
+        with self.lock:
+            self.pending.append(record)
+            self.count += 1
+            if len(self.pending) >= self.flush_every:
+                self._flush()
+
+    def _flush(self):
+        self.file.write(b''.join(self.pending))
+        self.file.flush()
+        self.pending = []
+
+    def close(self):
+        with self.lock:
+            self._flush()
+            self.file.close()
+
+
+def read_trace(path):
+    """Yield the samples of a trace file in recording order."""
+    with open(path, 'rb') as f:
+        header = f.read(HEADER.size)
+        if len(header) < HEADER.size:
+            raise ValueError(f"{path}: not a radar trace")
+        magic, version, record_size = HEADER.unpack(header)
+        if magic != MAGIC or version != VERSION or record_size != RECORD.size:
+            raise ValueError(f"{path}: unsupported trace format")
+
+        while True:
+            chunk = f.read(record_size * 4096)
+            if not chunk:
+                break
+            for offset in range(0, len(chunk) - record_size + 1, record_size):
+                yield unpack_record(chunk, offset)
@@ -0,0 +1,346 @@
+#!/usr/bin/env python3
+"""
+Replay a recorded radar trace against the dashboard server.
+Plays the samples back at real speed, N times real speed or as fast as
+possible, over UDP or HTTP, and reports the sustained send rate. Each
+recorded device is played as its own simulated device, `--devices` times
+over. With UDP the server's per-device latency counters are fetched at the
+end; with HTTP the time from a sample falling due to its response is
+reported.
+
+    python3 replay.py capture.rtrc --speed 10 --devices 8
+    python3 replay.py capture.rtrc --speed 0 --transport http
+    python3 replay.py capture.rtrc --speed 0 --change-only
+    python3 replay.py capture.rtrc --speed 0 --devices 16 --metrics
+"""
+
+import argparse
+import http.client
+import json
+import socket
+import threading
+import time
+
+from metrics import parse_text
+from radar_trace import read_trace
+from udp_stream import MAX_SAMPLES, encode_datagram
+
+# Simulated device ids start here so they never clash with real ESP32s
+DEVICE_BASE = 0xF0000000
+
+
+class DeviceMap:
+    """Simulated devices for the recorded ones: `copies` of each, numbered
+    copy by copy from 0."""
+
+    def __init__(self, samples, copies):
+        self.slots = {dev: i for i, dev in enumerate(sorted({s['device'] for s in samples}))}
+        self.copies = copies
+        self.count = len(self.slots) * copies
+
+    def targets(self, sample):
+        slot = self.slots[sample['device']]
+        return range(slot, self.count, len(self.slots))
+
+
+class ChangeFilter:
+    """Host copy of the firmware's change-only mode (components/scan_head/scan_delta.c).
+
+    Passes a sample when its angle's range moved more than `threshold_mm`,
+    a return appeared or vanished, an unchanged return was last sent
+    `timeout_s` ago, the bin is owed to the periodic keyframe, or it is one
+    of the sweep ends, which mark the sweeps for the server's hold.
+    """
+
+    def __init__(self, threshold_mm=30, timeout_s=30.0, keyframe_s=60.0, ends=(180, 360)):
+        self.threshold_mm = threshold_mm
+        self.timeout_s = timeout_s
+        self.keyframe_s = keyframe_s
+        self.ends = ends
+        self.last = {}
+        self.keyframe_t = None
+        self.keyframe_sent = set()
+        self.passed = 0
+        self.skipped = 0
+
+    def check(self, sample):
+        t = sample['timestamp']
+        angle = (sample['device'], sample['angle'])
+        mm = int(round(sample['distance'] * 10)) if sample['distance'] > 0 else -1
+        if self.keyframe_t is None or t - self.keyframe_t >= self.keyframe_s:
+            self.keyframe_t = t
+            self.keyframe_sent = set()
+
+        last = self.last.get(angle)
+        if angle not in self.keyframe_sent:
+            send = True
+            self.keyframe_sent.add(angle)
+        elif (mm < 0) != (last[0] < 0):
+            send = True
+        elif mm >= 0 and abs(mm - last[0]) > self.threshold_mm:
+            send = True
+        else:
+            send = mm >= 0 and t - last[1] >= self.timeout_s
+
+        if send:
+            self.last[angle] = (mm, t)
+        else:
+            send = sample['angle'] in self.ends
+        if send:
+            self.passed += 1
+        else:
+            self.skipped += 1
+        return send
+
+
+class UdpSender:
+    """Batches due samples into one datagram per device, like the firmware."""
+
+    def __init__(self, host, port, devices, boot):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.addr = (host, port)
+        self.devices = devices
+        self.boot = boot
+        self.dgram_seq = [0] * devices.count
+        self.sample_seq = [0] * devices.count
+        self.pending = [[] for _ in range(devices.count)]
+        self.sent = 0
+
+    def add(self, sample):
+        now_ms = int(time.time() * 1000) & 0xFFFFFFFF
+        distance = int(round(sample['distance'] * 10)) if sample['distance'] > 0 else -1
+        for dev in self.devices.targets(sample):
+            self.pending[dev].append((self.sample_seq[dev], now_ms, self.boot, sample['angle'], distance))
+            self.sample_seq[dev] += 1
+            if len(self.pending[dev]) == MAX_SAMPLES:
+                self._send(dev)
+
+    def flush(self):
+        for dev in range(self.devices.count):
+            if self.pending[dev]:
+                self._send(dev)
+
+    def _send(self, dev):
+        data = encode_datagram(DEVICE_BASE + dev, self.boot, self.dgram_seq[dev],
+                               int(time.time() * 1000), self.pending[dev])
+        self.sock.sendto(data, self.addr)
+        self.dgram_seq[dev] += 1
+        self.sent += len(self.pending[dev])
+        self.pending[dev] = []
+
+
+class HttpSender:
+    """One keep-alive connection and worker thread per simulated device."""
+
+    def __init__(self, host, port, devices, boot):
+        self.host = host
+        self.port = port
+        self.boot = boot
+        self.devices = devices
+        self.queues = [[] for _ in range(devices.count)]
+        self.cond = threading.Condition()
+        self.done = False
+        self.sent = 0
+        self.errors = 0
+        # Sample due to its response received, s
+        self.latencies = []
+        self.workers = [threading.Thread(target=self._run, args=(dev,), daemon=True)
+                        for dev in range(devices.count)]
+        for w in self.workers:
+            w.start()
+
+    def add(self, sample):
+        due = time.monotonic()
+        with self.cond:
+            for dev in self.devices.targets(sample):
+                self.queues[dev].append((sample, due))
+            self.cond.notify_all()
+
+    def flush(self):
+        pass
+
+    def close(self):
+        with self.cond:
+            self.done = True
+            self.cond.notify_all()
+        for w in self.workers:
+            w.join()
+
+    def _run(self, dev):
+        conn = http.client.HTTPConnection(self.host, self.port)
+        seq = 0
+        while True:
+            with self.cond:
+                while not self.queues[dev] and not self.done:
+                    self.cond.wait()
+                if not self.queues[dev]:
+                    return
+                batch, self.queues[dev] = self.queues[dev], []
+
+            for sample, due in batch:
+                body = json.dumps({
+                    'angle': sample['angle'],
+                    'distance': sample['distance'],
+                    'dev': DEVICE_BASE + dev,
+                    'boot': self.boot,
+                    'seq': seq,
+                    'ts': int(time.time() * 1000) & 0xFFFFFFFF
+                })
+                seq += 1
+                try:
+                    conn.request('POST', '/api/radar', body, {'Content-Type': 'application/json'})
+                    conn.getresponse().read()
+                    latency = time.monotonic() - due
+                    with self.cond:
+                        self.sent += 1
+                        self.latencies.append(latency)
+                except (OSError, http.client.HTTPException):
+                    with self.cond:
+                        self.errors += 1
+                    conn.close()
+                    conn = http.client.HTTPConnection(self.host, self.port)
+
+
+def report_latency(latencies):
+    """Percentiles of the HTTP sample-due-to-response times."""
+    if not latencies:
+        return
+    ordered = sorted(latencies)
+
+    def pct(p):
+        return ordered[min(int(len(ordered) * p), len(ordered) - 1)] * 1e3
+
+    print(f"HTTP latency, due to response: avg {sum(ordered) / len(ordered) * 1e3:.1f} ms, "
+          f"p50 {pct(0.5):.1f} ms, p99 {pct(0.99):.1f} ms, max {ordered[-1] * 1e3:.1f} ms")
+
+
+def scrape(host, port):
+    conn = http.client.HTTPConnection(host, port, timeout=5)
+    conn.request('GET', '/metrics')
+    return parse_text(conn.getresponse().read().decode())
+
+
+def report_metrics(before, after, sent):
+    """Server-side cost of the samples sent, from two /metrics scrapes."""
+    def delta(name):
+        return after.get(name, 0.0) - before.get(name, 0.0)
+
+    cpu = delta('process_cpu_seconds_total')
+    print(f"Server CPU {cpu:.2f} s, {cpu / max(sent, 1) * 1e6:.1f} us/sample")
+    for name, label in (('radar_ingest_seconds', 'ingest'),
+                        ('radar_decode_seconds{transport="udp"}', 'UDP decode'),
+                        ('radar_decode_seconds{transport="http"}', 'HTTP decode'),
+                        ('radar_broadcast_seconds{event="radar_update"}', 'radar_update emit')):
+        base, _, labels = name.partition('{')
+        labels = '{' + labels if labels else ''
+        count = delta(base + '_count' + labels)
+        if count:
+            print(f"  {label}: {delta(base + '_sum' + labels) / count * 1e6:.1f} us avg over {count:.0f}")
+
+
+def replay(samples, sender, speed, change_filter=None):
+    """Send samples on the recorded timeline scaled by `speed` (0 = no waiting)."""
+    start = time.monotonic()
+    t0 = None
+    count = 0
+    for sample in samples:
+        if t0 is None:
+            t0 = sample['timestamp']
+        if speed > 0:
+            due = start + (sample['timestamp'] - t0) / speed
+            delay = due - time.monotonic()
+            if delay > 0:
+                # Nothing else is due before this sample, ship what is batched
+                sender.flush()
+                time.sleep(delay)
+        if change_filter is None or change_filter.check(sample):
+            sender.add(sample)
+        count += 1
+    sender.flush()
+    return count, time.monotonic() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Replay a recorded radar trace')
+    parser.add_argument('trace', help='Trace file written by radar_server.py --record')
+    parser.add_argument('--host', default='127.0.0.1', help='Server address (default: 127.0.0.1)')
+    parser.add_argument('--transport', choices=['udp', 'http'], default='udp')
+    parser.add_argument('--http-port', type=int, default=5000)
+    parser.add_argument('--udp-port', type=int, default=5001)
+    parser.add_argument('--speed', type=float, default=1.0,
+                        help='Playback speed factor, 0 for as fast as possible (default: 1)')
+    parser.add_argument('--devices', type=int, default=1,
+                        help='Simulated devices per recorded device (default: 1)')
+    parser.add_argument('--loops', type=int, default=1, help='Times to play the trace (default: 1)')
+    parser.add_argument('--change-only', action='store_true',
+                        help='Send only changed angles, like the firmware CHANGE_ONLY_MODE')
+    parser.add_argument('--threshold-mm', type=int, default=30, help='Change-only range threshold (default: 30)')
+    parser.add_argument('--metrics', action='store_true',
+                        help="Report the server's CPU and ingest time per sample from /metrics")
+    args = parser.parse_args()
+
+    samples = list(read_trace(args.trace))
+    if not samples:
+        print("Trace is empty")
+        return
+    duration = samples[-1]['timestamp'] - samples[0]['timestamp']
+    devices = DeviceMap(samples, args.devices)
+    print(f"{len(samples)} samples from {len(devices.slots)} device(s), {duration:.1f} s recorded, "
+          f"{devices.count} simulated device(s), speed {'max' if args.speed <= 0 else args.speed}")
+
+    # Fresh boot id so the server does not de-duplicate against earlier runs
+    boot = int(time.time()) & 0xFFFF
+    if args.transport == 'udp':
+        sender = UdpSender(args.host, args.udp_port, devices, boot)
+    else:
+        sender = HttpSender(args.host, args.http_port, devices, boot)
+
+    change_filter = ChangeFilter(args.threshold_mm) if args.change_only else None
+    before = None
+    if args.metrics:
+        try:
+            before = scrape(args.host, args.http_port)
+        except (OSError, ValueError) as e:
+            print(f"Could not fetch server metrics: {e}")
+    start = time.monotonic()
+    total = 0
+    for _ in range(args.loops):
+        count, _ = replay(samples, sender, args.speed, change_filter)
+        total += count
+    if isinstance(sender, HttpSender):
+        # Wait for the workers to finish what is queued
+        sender.close()
+        print(f"HTTP errors: {sender.errors}")
+        report_latency(sender.latencies)
+    elapsed = time.monotonic() - start
+
+    print(f"Sent {sender.sent} samples in {elapsed:.2f} s: {sender.sent / elapsed:.0f} samples/s "
+          f"({total / elapsed:.0f} trace samples/s)")
+    if change_filter is not None:
+        print(f"Change-only: {change_filter.passed} of {total} trace samples sent, "
+              f"{total / max(change_filter.passed, 1):.1f}x less traffic")
+
+    if before is not None:
+        time.sleep(0.5)
+        try:
+            report_metrics(before, scrape(args.host, args.http_port), sender.sent)
+        except (OSError, ValueError) as e:
+            print(f"Could not fetch server metrics: {e}")
+
+    if args.transport == 'udp':
+        time.sleep(0.5)
+        try:
+            conn = http.client.HTTPConnection(args.host, args.http_port, timeout=5)
+            conn.request('GET', '/api/udp/stats')
+            stats = json.loads(conn.getresponse().read())
+        except (OSError, ValueError) as e:
+            print(f"Could not fetch server stats: {e}")
+            return
+        for dev, s in sorted(stats['devices'].items()):
+            if int(dev) >= DEVICE_BASE:
+                print(f"  device {int(dev):08x}: {s['samples']} samples, loss {s['loss_rate']:.2%}, "
+                      f"latency avg {s['latency_ms']['avg']} ms max {s['latency_ms']['max']} ms")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""
+Shared world map for several radar nodes.
+Every node has a pose (position and heading); its samples are projected into
+one Cartesian world frame and kept in a uniform grid index for fast region
+and nearest-neighbour queries. Points expire after a fixed age.
+
+Synthetic multi-node benchmark:
+    python3 spatial.py --nodes 16 --rate 100
+"""
+
+from collections import deque
+import math
+import threading
+import time
+
+from tracker import polar_to_xy
+
+CELL_CM = 25.0
+POINT_TTL_S = 10.0
+MAX_POINTS = 200000
+
+
+class Pose:
+    """Node position (cm) and heading of its boresight (degrees, world frame, CCW from +x)."""
+
+    __slots__ = ('x', 'y', 'heading', '_sin', '_cos')
+
+    def __init__(self, x=0.0, y=0.0, heading=90.0):
+        self.x = float(x)
+        self.y = float(y)
+        self.heading = float(heading)
+        rad = math.radians(self.heading)
+        self._sin = math.sin(rad)
+        self._cos = math.cos(rad)
+
+    def project(self, angle_deg, distance_cm):
+        """Map a sample to world coordinates."""
+        sx, sy = polar_to_xy(angle_deg, distance_cm)
+        # Sensor y (ahead) -> heading, sensor x (right) -> heading - 90
+        return (self.x + sx * self._sin + sy * self._cos,
+                self.y - sx * self._cos + sy * self._sin)
+
+    def to_dict(self):
+        return {'x': self.x, 'y': self.y, 'heading': self.heading}
+
+
+class GridIndex:
+    """Uniform grid of point buckets.
+
+    Points are appended to their cell and to a global FIFO, so inserts and
+    expiry are O(1) amortized. Queries only visit the cells they overlap.
+    """
+
+    def __init__(self, cell=CELL_CM, ttl=POINT_TTL_S, max_points=MAX_POINTS):
+        self.cell = cell
+        self.ttl = ttl
+        self.max_points = max_points
+        self.cells = {}
+        self.fifo = deque()
+        # Key range ever occupied; bounds the nearest-neighbour ring search
+        self.bounds = None
+        self.lock = threading.Lock()
+
+    def _key(self, x, y):
+        return int(math.floor(x / self.cell)), int(math.floor(y / self.cell))
+
+    def _expire(self, now):
+        fifo = self.fifo
+        while fifo and (fifo[0][0] < now - self.ttl or len(fifo) > self.max_points):
+            _, key = fifo.popleft()
+            bucket = self.cells[key]
+            bucket.popleft()
+            if not bucket:
+                del self.cells[key]
+        if not self.cells:
+            self.bounds = None
+
+    def insert(self, x, y, t, device):
+        key = self._key(x, y)
+        with self.lock:
+            bucket = self.cells.get(key)
+            if bucket is None:
+                bucket = self.cells[key] = deque()
+                b = self.bounds
+                if b is None:
+                    self.bounds = [key[0], key[1], key[0], key[1]]
+                elif not (b[0] <= key[0] <= b[2] and b[1] <= key[1] <= b[3]):
+                    b[0], b[1] = min(b[0], key[0]), min(b[1], key[1])
+                    b[2], b[3] = max(b[2], key[0]), max(b[3], key[1])
+            bucket.append((x, y, t, device))
+            self.fifo.append((t, key))
+            self._expire(t)
+
+    def __len__(self):
+        return len(self.fifo)
+
+    def region(self, x0, y0, x1, y1, now=None):
+        """Points inside the rectangle."""
+        now = time.time() if now is None else now
+        kx0, ky0 = self._key(min(x0, x1), min(y0, y1))
+        kx1, ky1 = self._key(max(x0, x1), max(y0, y1))
+        lo_x, hi_x = min(x0, x1), max(x0, x1)
+        lo_y, hi_y = min(y0, y1), max(y0, y1)
+        result = []
+        with self.lock:
+            self._expire(now)
+            cells = self.cells
+            # Sparse maps: walking the occupied cells beats walking a huge rectangle
+            if (kx1 - kx0 + 1) * (ky1 - ky0 + 1) > len(cells):
+                keys = [k for k in cells if kx0 <= k[0] <= kx1 and ky0 <= k[1] <= ky1]
+            else:
+                keys = [(kx, ky) for kx in range(kx0, kx1 + 1) for ky in range(ky0, ky1 + 1) if (kx, ky) in cells]
+            for key in keys:
+                for p in cells[key]:
+                    if lo_x <= p[0] <= hi_x and lo_y <= p[1] <= hi_y:
+                        result.append(p)
+        return result
+
+    def nearest(self, x, y, k=1, max_dist=None, now=None):
+        """Up to k points closest to (x, y), as (distance, point), nearest first."""
+        now = time.time() if now is None else now
+        cx, cy = self._key(x, y)
+        best = []
+        with self.lock:
+            self._expire(now)
+            if not self.cells:
+                return []
+            ring = 0
+            b = self.bounds
+            max_ring = max(abs(b[0] - cx), abs(b[2] - cx), abs(b[1] - cy), abs(b[3] - cy))
+            if max_dist is not None:
+                max_ring = min(max_ring, int(max_dist / self.cell) + 1)
+            while ring <= max_ring:
+                for kx in range(cx - ring, cx + ring + 1):
+                    for ky in (cy - ring, cy + ring) if abs(kx - cx) != ring else range(cy - ring, cy + ring + 1):
+                        for p in self.cells.get((kx, ky), ()):
+                            d = math.hypot(p[0] - x, p[1] - y)
+                            if max_dist is None or d <= max_dist:
+                                best.append((d, p))
+                best.sort(key=lambda e: e[0])
+                del best[k:]
+                # Anything in the next ring is at least `ring * cell` away
+                if len(best) == k and best[-1][0] <= ring * self.cell:
+                    break
+                ring += 1
+        return best
+
+
+def point_dict(p):
+    return {'x': round(p[0], 1), 'y': round(p[1], 1), 't': p[2], 'device': p[3]}
+
+
+def main():
+    import argparse
+    import random
+
+    parser = argparse.ArgumentParser(description='Synthetic multi-node map benchmark')
+    parser.add_argument('--nodes', type=int, default=8)
+    parser.add_argument('--rate', type=float, default=100.0, help='Samples per second per node')
+    parser.add_argument('--seconds', type=float, default=10.0, help='Simulated duration')
+    parser.add_argument('--queries', type=int, default=2000)
+    args = parser.parse_args()
+
+    poses = [Pose(random.uniform(0, 1000), random.uniform(0, 1000), random.uniform(0, 360))
+             for _ in range(args.nodes)]
+    index = GridIndex()
+    total = int(args.nodes * args.rate * args.seconds)
+
+    start = time.perf_counter()
+    t = 0.0
+    for i in range(total):
+        node = i % args.nodes
+        t = i / (args.nodes * args.rate)
+        x, y = poses[node].project(random.randint(90, 180) * 2, random.uniform(5, 200))
+        index.insert(x, y, t, node)
+    insert_us = (time.perf_counter() - start) / total * 1e6
+
+    start = time.perf_counter()
+    hits = 0
+    for _ in range(args.queries):
+        qx, qy = random.uniform(0, 1000), random.uniform(0, 1000)
+        hits += len(index.region(qx - 50, qy - 50, qx + 50, qy + 50, now=t))
+    region_us = (time.perf_counter() - start) / args.queries * 1e6
+
+    start = time.perf_counter()
+    for _ in range(args.queries):
+        index.nearest(random.uniform(0, 1000), random.uniform(0, 1000), k=5, now=t)
+    nearest_us = (time.perf_counter() - start) / args.queries * 1e6
+
+    print(f"{args.nodes} nodes x {args.rate:.0f} samples/s, {total} inserts, {len(index)} live points")
+    print(f"insert {insert_us:.2f} us, 1 m^2 region {region_us:.1f} us ({hits / args.queries:.0f} pts), "
+          f"5-NN {nearest_us:.1f} us")
+
+
+if __name__ == '__main__':
+    main()
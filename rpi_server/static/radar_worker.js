@@ -0,0 +1,276 @@
+// Multi-device radar renderer, runs in a Web Worker.
+// Draws every device into one OffscreenCanvas grid, fed with the binary
+// frames of frames.py. The page only forwards buffers and shows the
+// readouts this worker posts back.
+
+const FRAME_MAGIC = 0x5246;
+const FRAME_VERSION = 1;
+const HEADER_SIZE = 12;
+const RECORD_SIZE = 8;
+
+const maxDistance = 200; // cm
+const binStaleMs = 10000; // a few sweeps, held bins are replayed every sweep
+const statsWindow = 240; // frames
+
+let canvas = null;
+let ctx = null;
+let width = 0;
+let height = 0;
+let readoutMs = 250;
+
+// device id -> per-device state, in arrival order
+const devices = new Map();
+let layout = null;
+let gridCache = null;
+let dirty = true;
+
+// Frame time ring, ms
+const frameTimes = new Float32Array(statsWindow);
+let frameCount = 0;
+let samplesIn = 0;
+let framesIn = 0;
+let droppedIn = 0;
+let lastLatencyMs = 0;
+// Frame latencies since the last readout, reported to the server's metrics
+const latencies = [];
+const maxLatencies = 256;
+
+function newDevice(id) {
+    return {
+        id: id,
+        ranges: new Float32Array(361).fill(-1), // cm per angle
+        stamps: new Float64Array(361),
+        angle: 180,
+        distance: -1,
+        samples: 0,
+        rate: 0,
+        rateSamples: 0
+    };
+}
+
+// Square-ish grid of cells, each holding a half-disc radar
+function computeLayout(n) {
+    const cols = Math.max(1, Math.ceil(Math.sqrt(n * width / height / 2)));
+    const rows = Math.max(1, Math.ceil(n / cols));
+    const cellW = Math.floor(width / cols);
+    const cellH = Math.floor(height / rows);
+    const radius = Math.max(4, Math.min(cellW / 2 - 6, cellH - 20));
+    return { cols, rows, cellW, cellH, radius, cx: cellW / 2, cy: cellH - 8 };
+}
+
+// Grid is the same in every cell: render it once per layout and blit it
+function renderGridCache() {
+    gridCache = new OffscreenCanvas(layout.cellW, layout.cellH);
+    const g = gridCache.getContext('2d');
+    const { cx, cy, radius } = layout;
+
+    g.strokeStyle = '#0a0';
+    g.lineWidth = 1;
+    g.strokeRect(0.5, 0.5, layout.cellW - 1, layout.cellH - 1);
+    for (let i = 1; i <= 4; i++) {
+        g.beginPath();
+        g.arc(cx, cy, radius * i / 4, Math.PI, 0, false);
+        g.stroke();
+    }
+    g.beginPath();
+    for (let angle = 180; angle <= 360; angle += 30) {
+        const rad = (angle * Math.PI) / 180;
+        g.moveTo(cx, cy);
+        g.lineTo(cx + radius * Math.cos(rad), cy + radius * Math.sin(rad));
+    }
+    g.stroke();
+}
+
+function relayout() {
+    if (!canvas || devices.size === 0)
+        return;
+    layout = computeLayout(devices.size);
+    renderGridCache();
+    dirty = true;
+}
+
+function ingest(buf) {
+    if (buf.byteLength < HEADER_SIZE)
+        return;
+    const view = new DataView(buf);
+    if (view.getUint16(0, true) !== FRAME_MAGIC || view.getUint8(2) !== FRAME_VERSION)
+        return;
+    const count = view.getUint16(4, true);
+    if (buf.byteLength < HEADER_SIZE + count * RECORD_SIZE)
+        return;
+
+    droppedIn += view.getUint16(6, true);
+    // Server stamp is wall time mod 2^32 ms
+    let latency = Date.now() % 4294967296 - view.getUint32(8, true);
+    if (latency < -2147483648)
+        latency += 4294967296;
+    else if (latency > 2147483647)
+        latency -= 4294967296;
+    lastLatencyMs = latency;
+    if (latencies.length < maxLatencies)
+        latencies.push(latency);
+    framesIn++;
+    samplesIn += count;
+
+    const now = Date.now();
+    let added = false;
+    for (let i = 0, off = HEADER_SIZE; i < count; i++, off += RECORD_SIZE) {
+        const id = view.getUint32(off, true);
+        const angle = view.getInt16(off + 4, true);
+        const mm = view.getInt16(off + 6, true);
+        let dev = devices.get(id);
+        if (dev === undefined) {
+            dev = newDevice(id);
+            devices.set(id, dev);
+            added = true;
+        }
+        const distance = mm >= 0 ? mm / 10 : -1;
+        dev.angle = angle;
+        dev.distance = distance;
+        dev.samples++;
+        if (angle >= 0 && angle <= 360) {
+            dev.ranges[angle] = distance;
+            dev.stamps[angle] = now;
+        }
+    }
+    if (added)
+        relayout();
+    dirty = true;
+}
+
+function drawDevice(dev, x0, y0, now) {
+    const { cx, cy, radius } = layout;
+    const scale = radius / maxDistance;
+    const ox = x0 + cx;
+    const oy = y0 + cy;
+
+    ctx.drawImage(gridCache, x0, y0);
+
+    // Persistent per-angle blips, one path per device
+    ctx.fillStyle = 'rgba(255, 0, 0, 0.7)';
+    ctx.beginPath();
+    const size = Math.max(2, radius / 40);
+    for (let a = 180; a <= 360; a++) {
+        const d = dev.ranges[a];
+        if (d <= 0 || d >= maxDistance)
+            continue;
+        if (now - dev.stamps[a] > binStaleMs) {
+            dev.ranges[a] = -1;
+            continue;
+        }
+        const rad = (a * Math.PI) / 180;
+        ctx.rect(ox + d * scale * Math.cos(rad) - size / 2, oy + d * scale * Math.sin(rad) - size / 2, size, size);
+    }
+    ctx.fill();
+
+    // Sweep line
+    const rad = (dev.angle * Math.PI) / 180;
+    ctx.strokeStyle = '#0f0';
+    ctx.lineWidth = 2;
+    ctx.beginPath();
+    ctx.moveTo(ox, oy);
+    ctx.lineTo(ox + radius * Math.cos(rad), oy + radius * Math.sin(rad));
+    ctx.stroke();
+
+    ctx.fillStyle = '#0a0';
+    ctx.fillText(formatId(dev.id), x0 + 4, y0 + 12);
+}
+
+function render() {
+    if (dirty && layout) {
+        const start = performance.now();
+        const now = Date.now();
+        ctx.fillStyle = '#000';
+        ctx.fillRect(0, 0, width, height);
+        ctx.font = '10px Courier New';
+
+        let i = 0;
+        devices.forEach((dev) => {
+            const col = i % layout.cols;
+            const row = Math.floor(i / layout.cols);
+            drawDevice(dev, col * layout.cellW, row * layout.cellH, now);
+            i++;
+        });
+
+        frameTimes[frameCount % statsWindow] = performance.now() - start;
+        frameCount++;
+        dirty = false;
+    }
+    scheduleRender();
+}
+
+function scheduleRender() {
+    if (typeof requestAnimationFrame === 'function')
+        requestAnimationFrame(render);
+    else
+        setTimeout(render, 16);
+}
+
+function formatId(id) {
+    return '0x' + id.toString(16).toUpperCase();
+}
+
+function frameStats() {
+    const n = Math.min(frameCount, statsWindow);
+    if (n === 0)
+        return { frames: 0, avgMs: 0, p95Ms: 0, maxMs: 0 };
+    const sorted = Array.from(frameTimes.subarray(0, n)).sort((a, b) => a - b);
+    let sum = 0;
+    for (let i = 0; i < n; i++)
+        sum += sorted[i];
+    return {
+        frames: frameCount,
+        avgMs: sum / n,
+        p95Ms: sorted[Math.min(n - 1, Math.floor(n * 0.95))],
+        maxMs: sorted[n - 1]
+    };
+}
+
+// Readouts go back to the page at a fixed rate, never per sample
+let lastReadout = performance.now();
+let lastFrameCount = 0;
+function postReadout() {
+    const now = performance.now();
+    const dt = (now - lastReadout) / 1000;
+    const list = [];
+    devices.forEach((dev) => {
+        dev.rate = (dev.samples - dev.rateSamples) / dt;
+        dev.rateSamples = dev.samples;
+        list.push({ id: formatId(dev.id), angle: dev.angle, distance: dev.distance, rate: dev.rate });
+    });
+    const stats = frameStats();
+    stats.fps = (frameCount - lastFrameCount) / dt;
+    stats.devices = devices.size;
+    stats.samplesPerSec = samplesIn / dt;
+    stats.messagesPerSec = framesIn / dt;
+    stats.dropped = droppedIn;
+    stats.latencyMs = lastLatencyMs;
+    lastFrameCount = frameCount;
+    samplesIn = 0;
+    framesIn = 0;
+    lastReadout = now;
+    postMessage({ type: 'readout', devices: list, stats: stats, latencies: latencies.splice(0) });
+}
+
+onmessage = (e) => {
+    const msg = e.data;
+    switch (msg.type) {
+    case 'init':
+        canvas = msg.canvas;
+        ctx = canvas.getContext('2d');
+        width = canvas.width;
+        height = canvas.height;
+        readoutMs = msg.readoutMs || readoutMs;
+        setInterval(postReadout, readoutMs);
+        scheduleRender();
+        break;
+    case 'resize':
+        canvas.width = width = msg.width;
+        canvas.height = height = msg.height;
+        relayout();
+        break;
+    case 'frame':
+        ingest(msg.buf);
+        break;
+    }
+};
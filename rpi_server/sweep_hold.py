@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""
+Full sweeps from change-only devices.
+In change-only mode (CHANGE_ONLY_MODE in main/radar_sensor.c) the ESP32 only
+sends bearings whose range moved, unchanged returns every DELTA_TIMEOUT_MS,
+every bearing once per DELTA_KEYFRAME_MS, and both ends of every sweep. The
+tracker, map expiry, history hit counts and the dashboards expect every
+bearing every sweep, so the last value per bearing is held and replayed for
+the bearings the head passed over without reporting them. A full stream
+goes through unchanged: consecutive samples are adjacent bearings.
+
+Check the expansion against a synthetic full stream:
+    python3 sweep_hold.py --sweeps 200
+"""
+
+import time
+
+# Firmware change-only timing, see DELTA_* in main/radar_sensor.c
+DELTA_TIMEOUT_S = 30.0
+DELTA_KEYFRAME_S = 60.0
+
+# A held value is re-reported within the firmware's interval plus the sweep
+# that carries it; past that the device stopped reporting the bearing and it
+# is left to go stale
+HOLD_SLACK_S = 5.0
+
+
+class SweepHold:
+    """Last reported value per bearing of one device; feed live samples in arrival order."""
+
+    def __init__(self, return_ttl=DELTA_TIMEOUT_S + HOLD_SLACK_S, empty_ttl=DELTA_KEYFRAME_S + HOLD_SLACK_S):
+        self.return_ttl = return_ttl
+        self.empty_ttl = empty_ttl
+        self.held = {}
+        self.last_angle = None
+        self.replayed = 0
+
+    def expand(self, angle, distance, t):
+        """Return (angle, distance) for the bearings passed since the last sample, then this one."""
+        angle = int(angle)
+        out = []
+        prev = self.last_angle
+        if prev is not None and abs(angle - prev) > 1:
+            step = 1 if angle > prev else -1
+            held = self.held
+            for a in range(prev + step, angle, step):
+                h = held.get(a)
+                if h is None:
+                    continue
+                d, reported = h
+                if t - reported > (self.return_ttl if d > 0 else self.empty_ttl):
+                    del held[a]
+                    continue
+                out.append((a, d))
+            self.replayed += len(out)
+
+        self.held[angle] = (distance, t)
+        self.last_angle = angle
+        out.append((angle, distance))
+        return out
+
+
+def main():
+    import argparse
+    import math
+    import random
+    from replay import ChangeFilter
+
+    parser = argparse.ArgumentParser(description='Change-only sweep reconstruction check')
+    parser.add_argument('--sweeps', type=int, default=200)
+    parser.add_argument('--step', type=int, default=3, help='Degrees between bearings')
+    parser.add_argument('--sweep-s', type=float, default=2.0, help='Seconds per sweep')
+    args = parser.parse_args()
+
+    # Two static walls and a target crossing the field, ranges in cm
+    def scene(angle, t):
+        if abs(angle - (200 + (t * 5) % 140)) < 6:
+            return 60.0 + 10 * math.sin(t / 7)
+        if angle < 230:
+            return 150.0 + random.uniform(-1, 1)
+        if angle > 320:
+            return 120.0 + random.uniform(-1, 1)
+        return -1.0
+
+    bearings = list(range(180, 361, args.step))
+    if bearings[-1] != 360:
+        bearings.append(360)
+    dt = args.sweep_s / len(bearings)
+
+    change = ChangeFilter()
+    hold = SweepHold()
+    truth = {}
+    full = sent = worst = 0
+    fail = False
+    t = 0.0
+    start = time.perf_counter()
+    for sweep in range(args.sweeps):
+        order = bearings if sweep % 2 == 0 else bearings[::-1]
+        seen = {}
+        for angle in order:
+            t += dt
+            distance = scene(angle, t)
+            full += 1
+            truth[angle] = distance
+            sample = {'device': 1, 'angle': angle, 'distance': distance, 'timestamp': t}
+            if not change.check(sample):
+                continue
+            sent += 1
+            for a, d in hold.expand(angle, distance, t):
+                seen[a] = d
+
+        # Every bearing comes out each sweep, within the change threshold
+        if sweep and len(seen) != len(bearings):
+            fail = True
+        for a, d in seen.items():
+            err = abs(d - truth[a]) if (d > 0) == (truth[a] > 0) else float('inf')
+            if d > 0 and truth[a] > 0:
+                worst = max(worst, err)
+            # The filter compares ranges rounded to the millimetre
+            if err > change.threshold_mm / 10.0 + 0.1:
+                fail = True
+    elapsed = time.perf_counter() - start
+
+    print(f"{args.sweeps} sweeps of {len(bearings)} bearings: {sent} of {full} samples sent "
+          f"({full / sent:.1f}x less), {hold.replayed} held values replayed")
+    print(f"worst held range error {worst:.1f} cm (threshold {change.threshold_mm / 10.0:.1f} cm), "
+          f"{elapsed / sent * 1e6:.2f} us per sent sample")
+    print('FAIL' if fail else 'OK')
+    return 1 if fail else 0
+
+
+if __name__ == '__main__':
+    raise SystemExit(main())
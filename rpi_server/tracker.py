@@ -0,0 +1,222 @@
+#!/usr/bin/env python3
+"""
+Incremental target detection and tracking over radar sweeps.
+Adjacent angle/range returns are grouped into detections as samples arrive;
+when the sweep reverses, detections are associated with existing tracks
+(gated nearest neighbour) and the tracks are updated with an alpha-beta
+filter. Each sweep yields a short target list instead of hundreds of points.
+
+Run over a recorded trace to measure per-sample cost:
+    python3 tracker.py capture.rtrc
+"""
+
+import math
+import time
+
+# Clustering: consecutive returns closer than this belong to one detection
+ANGLE_GAP_DEG = 6
+RANGE_GAP_CM = 15.0
+MIN_POINTS = 2
+MAX_RANGE_CM = 200.0
+
+# Association and filtering
+GATE_CM = 30.0
+MAX_SPEED_CM_S = 100.0
+ALPHA = 0.6
+BETA = 0.2
+MAX_MISSES = 3
+MAX_TRACKS = 32
+MAX_DETECTIONS = 64
+
+
+def polar_to_xy(angle_deg, distance_cm):
+    """Sensor frame: x to the right, y straight ahead (270 degrees)."""
+    rad = math.radians(angle_deg)
+    return distance_cm * math.cos(rad), -distance_cm * math.sin(rad)
+
+
+class _Cluster:
+    __slots__ = ('n', 'sx', 'sy', 'angle_min', 'angle_max', 'last_angle', 'last_range', 't')
+
+    def __init__(self, angle, distance, t):
+        self.n = 0
+        self.sx = self.sy = 0.0
+        self.angle_min = self.angle_max = angle
+        self.t = t
+        self.add(angle, distance)
+
+    def add(self, angle, distance):
+        x, y = polar_to_xy(angle, distance)
+        self.n += 1
+        self.sx += x
+        self.sy += y
+        self.angle_min = min(self.angle_min, angle)
+        self.angle_max = max(self.angle_max, angle)
+        self.last_angle = angle
+        self.last_range = distance
+
+    def detection(self):
+        return {
+            'x': self.sx / self.n,
+            'y': self.sy / self.n,
+            'width_deg': self.angle_max - self.angle_min,
+            'points': self.n,
+            't': self.t
+        }
+
+
+class _Track:
+    __slots__ = ('id', 'x', 'y', 'vx', 'vy', 't', 'hits', 'misses', 'confidence')
+
+    def __init__(self, track_id, det):
+        self.id = track_id
+        self.x, self.y = det['x'], det['y']
+        self.vx = self.vy = 0.0
+        self.t = det['t']
+        self.hits = 1
+        self.misses = 0
+        self.confidence = 0.3
+
+    def predict(self, t):
+        dt = max(0.0, t - self.t)
+        return self.x + self.vx * dt, self.y + self.vy * dt, dt
+
+    def update(self, det):
+        px, py, dt = self.predict(det['t'])
+        rx, ry = det['x'] - px, det['y'] - py
+        self.x = px + ALPHA * rx
+        self.y = py + ALPHA * ry
+        if dt > 0:
+            self.vx += BETA * rx / dt
+            self.vy += BETA * ry / dt
+        self.t = det['t']
+        self.hits += 1
+        self.misses = 0
+        self.confidence += 0.3 * (1.0 - self.confidence)
+
+    def miss(self):
+        self.misses += 1
+        self.confidence *= 0.6
+
+    def to_dict(self):
+        return {
+            'id': self.id,
+            'x': round(self.x, 1),
+            'y': round(self.y, 1),
+            'vx': round(self.vx, 1),
+            'vy': round(self.vy, 1),
+            'confidence': round(self.confidence, 2)
+        }
+
+
+class Tracker:
+    """Per-device tracker; feed samples in arrival order with add()."""
+
+    def __init__(self):
+        self.tracks = []
+        self.next_id = 1
+        self.cluster = None
+        self.detections = []
+        self.last_angle = None
+        self.direction = 0
+        self.sweeps = 0
+
+    def add(self, angle, distance, t):
+        """Feed one sample; returns the target list when a sweep completes, else None."""
+        result = None
+
+        if self.last_angle is not None and angle != self.last_angle:
+            direction = 1 if angle > self.last_angle else -1
+            if self.direction and direction != self.direction:
+                result = self._end_sweep(t)
+            self.direction = direction
+        self.last_angle = angle
+
+        c = self.cluster
+        if 0 < distance < MAX_RANGE_CM:
+            if c and abs(angle - c.last_angle) <= ANGLE_GAP_DEG and abs(distance - c.last_range) <= RANGE_GAP_CM:
+                c.add(angle, distance)
+            else:
+                self._close_cluster()
+                self.cluster = _Cluster(angle, distance, t)
+        elif c and abs(angle - c.last_angle) > ANGLE_GAP_DEG:
+            self._close_cluster()
+
+        return result
+
+    def targets(self):
+        return [trk.to_dict() for trk in self.tracks]
+
+    def _close_cluster(self):
+        c = self.cluster
+        if c and c.n >= MIN_POINTS and len(self.detections) < MAX_DETECTIONS:
+            self.detections.append(c.detection())
+        self.cluster = None
+
+    def _end_sweep(self, t):
+        self._close_cluster()
+        self.sweeps += 1
+
+        # Gated nearest-neighbour association, closest pairs first
+        pairs = []
+        for ti, trk in enumerate(self.tracks):
+            for di, det in enumerate(self.detections):
+                px, py, dt = trk.predict(det['t'])
+                dist = math.hypot(det['x'] - px, det['y'] - py)
+                if dist <= GATE_CM + MAX_SPEED_CM_S * dt * 0.5:
+                    pairs.append((dist, ti, di))
+        pairs.sort()
+
+        used_tracks = set()
+        used_dets = set()
+        for _, ti, di in pairs:
+            if ti in used_tracks or di in used_dets:
+                continue
+            self.tracks[ti].update(self.detections[di])
+            used_tracks.add(ti)
+            used_dets.add(di)
+
+        for ti, trk in enumerate(self.tracks):
+            if ti not in used_tracks:
+                trk.miss()
+        self.tracks = [trk for trk in self.tracks if trk.misses <= MAX_MISSES]
+
+        for di, det in enumerate(self.detections):
+            if di not in used_dets and len(self.tracks) < MAX_TRACKS:
+                self.tracks.append(_Track(self.next_id, det))
+                self.next_id += 1
+
+        self.detections = []
+        return self.targets()
+
+
+def main():
+    import argparse
+    from radar_trace import read_trace
+
+    parser = argparse.ArgumentParser(description='Run the tracker over a recorded trace')
+    parser.add_argument('trace', help='Trace file written by radar_server.py --record')
+    args = parser.parse_args()
+
+    samples = list(read_trace(args.trace))
+    trackers = {}
+    sweeps = 0
+    targets = 0
+    start = time.perf_counter()
+    for s in samples:
+        trk = trackers.setdefault(s['device'], Tracker())
+        result = trk.add(s['angle'], s['distance'], s['timestamp'])
+        if result is not None:
+            sweeps += 1
+            targets += len(result)
+    elapsed = time.perf_counter() - start
+
+    print(f"{len(samples)} samples, {sweeps} sweeps, {len(trackers)} device(s)")
+    if samples:
+        print(f"{elapsed / len(samples) * 1e6:.2f} us/sample, {len(samples) / elapsed:.0f} samples/s")
+    if sweeps:
+        print(f"{targets / sweeps:.1f} targets/sweep vs {len(samples) / sweeps:.0f} samples/sweep")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+UDP datagram transport for radar samples.
+Decodes the binary datagrams sent by the ESP32 uplink in UDP mode and keeps
+per-device loss, reordering and latency counters.
+
+Datagram layout (little-endian), see components/uplink/include/uplink_encode.h:
+    header: magic u16, version u8, count u8, device u32, boot u16, reserved u16,
+            seq u32, send time ms u32
+    sample: seq u32, time ms u32, boot u16, angle i16, distance mm i32
+"""
+
+from collections import deque
+import random
+import socket
+import struct
+import threading
+import time
+
+MAGIC = 0x5244
+VERSION = 1
+HEADER = struct.Struct('<HBBIHHII')
+SAMPLE = struct.Struct('<IIHhi')
+MAX_DATAGRAM = 1400
+MAX_SAMPLES = (MAX_DATAGRAM - HEADER.size) // SAMPLE.size
+
+# Datagram sequence numbers remembered for duplicate detection
+SEQ_WINDOW = 1024
+
+
+def encode_datagram(device, boot, seq, sent_ms, samples):
+    """Build a datagram; samples are (seq, time_ms, boot, angle, distance_mm) tuples."""
+    parts = [HEADER.pack(MAGIC, VERSION, len(samples), device, boot, 0, seq, sent_ms & 0xFFFFFFFF)]
+    parts.extend(SAMPLE.pack(*s) for s in samples)
+    return b''.join(parts)
+
+
+def parse_datagram(data):
+    """Return (header dict, list of sample dicts), or None if malformed."""
+    if len(data) < HEADER.size:
+        return None
+    magic, version, count, device, boot, _, seq, sent_ms = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION or len(data) < HEADER.size + count * SAMPLE.size:
+        return None
+
+    header = {'device': device, 'boot': boot, 'seq': seq, 'sent_ms': sent_ms}
+    samples = []
+    for i in range(count):
+        s_seq, s_ms, s_boot, angle, distance_mm = SAMPLE.unpack_from(data, HEADER.size + i * SAMPLE.size)
+        samples.append({
+            'seq': s_seq,
+            'device_ts': s_ms,
+            'boot': s_boot,
+            'angle': angle,
+            'distance': distance_mm / 10.0 if distance_mm >= 0 else -1.0
+        })
+    return header, samples
+
+
+class StreamStats:
+    """Loss, reordering and one-way latency accounting for one device.
+
+    Device and server clocks are not synchronized, so latency is reported
+    relative to the fastest datagram seen (clock offset estimate): a flat
+    value means the link adds no queueing delay.
+    """
+
+    def __init__(self):
+        self.boot = None
+        self.received = 0
+        self.samples = 0
+        self.lost = 0
+        self.reordered = 0
+        self.duplicates = 0
+        self.latency_last_ms = 0.0
+        self.latency_avg_ms = 0.0
+        self.latency_max_ms = 0.0
+        self._reset_stream()
+
+    def _reset_stream(self):
+        self.highest = None
+        self.seen = set()
+        self.seen_order = deque()
+        self.offset_ms = None
+
+    def update(self, header, sample_count, rx_time):
+        """Account for one datagram; return False if it is a duplicate."""
+        if header['boot'] != self.boot:
+            # Device rebooted, sequence numbers and clock start over
+            self.boot = header['boot']
+            self._reset_stream()
+
+        seq = header['seq']
+        if seq in self.seen:
+            self.duplicates += 1
+            return False
+        self.seen.add(seq)
+        self.seen_order.append(seq)
+        if len(self.seen_order) > SEQ_WINDOW:
+            self.seen.discard(self.seen_order.popleft())
+
+        if self.highest is None:
+            self.highest = seq
+        elif seq > self.highest:
+            self.lost += seq - self.highest - 1
+            self.highest = seq
+        else:
+            # Counted as lost when the gap opened, it arrived after all
+            self.reordered += 1
+            self.lost = max(0, self.lost - 1)
+
+        self.received += 1
+        self.samples += sample_count
+
+        offset = rx_time * 1000.0 - header['sent_ms']
+        if self.offset_ms is None or offset < self.offset_ms:
+            self.offset_ms = offset
+        latency = offset - self.offset_ms
+        self.latency_last_ms = latency
+        self.latency_max_ms = max(self.latency_max_ms, latency)
+        self.latency_avg_ms += (latency - self.latency_avg_ms) / min(self.received, 100)
+        return True
+
+    def to_dict(self):
+        expected = self.received + self.lost
+        return {
+            'boot': self.boot,
+            'datagrams': self.received,
+            'samples': self.samples,
+            'lost': self.lost,
+            'loss_rate': self.lost / expected if expected else 0.0,
+            'reordered': self.reordered,
+            'duplicates': self.duplicates,
+            'latency_ms': {
+                'last': round(self.latency_last_ms, 2),
+                'avg': round(self.latency_avg_ms, 2),
+                'max': round(self.latency_max_ms, 2)
+            }
+        }
+
+
+class UdpReceiver(threading.Thread):
+    """Receives datagrams and hands every sample to `on_sample(device, sample)`.
+
+    `drop_rate` discards that fraction of datagrams on arrival to test loss
+    accounting on localhost. `decode_seconds` is an optional histogram
+    (metrics.py) timing the datagram decode.
+    """
+
+    def __init__(self, port, on_sample, host='0.0.0.0', drop_rate=0.0, decode_seconds=None):
+        super().__init__(daemon=True)
+        self.on_sample = on_sample
+        self.drop_rate = drop_rate
+        self.decode_seconds = decode_seconds
+        self.stats = {}
+        self.malformed = 0
+        self.injected_drops = 0
+        self.lock = threading.Lock()
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        self.sock.bind((host, port))
+
+    def run(self):
+        while True:
+            data, _ = self.sock.recvfrom(2048)
+            rx_time = time.time()
+            if self.drop_rate and random.random() < self.drop_rate:
+                self.injected_drops += 1
+                continue
+
+            start = time.perf_counter()
+            parsed = parse_datagram(data)
+            if self.decode_seconds is not None:
+                self.decode_seconds.observe(time.perf_counter() - start, ('udp',))
+            if parsed is None:
+                self.malformed += 1
+                continue
+            header, samples = parsed
+
+            with self.lock:
+                stats = self.stats.setdefault(header['device'], StreamStats())
+                fresh = stats.update(header, len(samples), rx_time)
+            if not fresh:
+                continue
+            for sample in samples:
+                self.on_sample(header['device'], sample)
+
+    def snapshot(self):
+        """Counters per device, as a JSON-friendly dict."""
+        with self.lock:
+            devices = {str(dev): s.to_dict() for dev, s in self.stats.items()}
+        return {
+            'devices': devices,
+            'malformed': self.malformed,
+            'injected_drops': self.injected_drops
+        }